@@ -1,311 +1,1894 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <queue>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace std;
 
-namespace Solver{
-    int numberOfTiles; // количество тайлов
-    int maximumSize; // максимальный размер квадрата, который проверяем
-    vector<vector<int>> tiles; // заданный набор тайлов 
+namespace Solver{
+    // Перебор направлений
+    // x - столбцы, y - строки
+    // противоположный - ^ 2
+    const vector<int> dx = {-1, 0, 1, 0}; // up, right, down, left
+    const vector<int> dy = {0, 1, 0, -1};  
+
+    // Клетка прямоугольника, пустая клетка - EMPTY_CELL
+    // Если вдруг numberOfTiles будет >= 255 - нужно поставить Cell = uint16_t
+    typedef uint8_t Cell;
+    const Cell EMPTY_CELL = numeric_limits<Cell>::max();
+
+    // Прямоугольник внутри плоского буфера: n строк по m клеток подряд
+    struct TableView {
+        const Cell* cells;
+        int n;
+        int m;
+
+        Cell get(int x, int y) const {
+            return cells[x * m + y];
+        }
+    };
+
+    vector<vector<int>> toMatrix(const TableView& table) {
+        vector<vector<int>> matrix(table.n, vector<int>(table.m));
+        for (int x = 0; x < table.n; ++x) {
+            for (int y = 0; y < table.m; ++y) {
+                matrix[x][y] = table.get(x, y);
+            }
+        }
+        return matrix;
+    }
+
+    // Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
+    const int N = 123;
+
+    // Как искать период (1 - перебор прямоугольников, 2 - циклы в графе полосок, 3 - перебор на торе,
+    // 4 - степени булевой матрицы графа полосок)
+    // В режимах 2, 3 и 4 maximumSize может быть >= N, но тогда для наборов без периода
+    // maximumTiledRectangle не считается (он есть только у перебора прямоугольников)
+    const int PERIOD_SEARCH_ENGINE = 1;
+
+    // Перебирать или не перебирать периоды x * 1 (1 - да, 2 - нет)
+    const int FIRST_SQUARE_OPTIMIZATION = 1;
+
+    // Перебирать или не перебирать периоды n * m, n < m (1 - да, 2 - нет)
+    const int LEXICOGRAPHIC_OPTIMIZATION = 1;
+
+    // Перед заполнением полоски сужать домены её клеток до тайлов, с которых полоска дозаполняется (1 - нет, 2 - да)
+    const int FORWARD_CHECKING_OPTIMIZATION = 2;
+
+    // Освобождать allTables[h - 1][w - 1], как только построен allTables[h][w] (1 - нет, 2 - да)
+    // Живут только две соседние строки корзин, а лучший незамощаемый прямоугольник запоминается сразу
+    const int ROLLING_FRONTIER_OPTIMIZATION = 2;
+
+    // Хранить прямоугольники с одинаковой границей один раз (1 - нет, 2 - да)
+    // Продолжение прямоугольника зависит только от последней строки и столбца, проверка периода -
+    // от первых и последних, так что из прямоугольников с одинаковой границей остаётся первый
+    const int BOUNDARY_OPTIMIZATION = 2;
+
+    // Перебирать размеры прямоугольников по возрастанию площади, при равной - периметра, а не по строкам (1 - нет, 2 - да)
+    // Первым находится период наименьшей площади, поэтому найденный период может отличаться от перебора по строкам
+    const int AREA_ORDER_OPTIMIZATION = 1;
+
+    // При том же числе тайлов не строить маски совместимости заново, а пересчитывать только позиции,
+    // где тайл поменялся по сравнению с прошлым solve() (1 - нет, 2 - да)
+    const int INCREMENTAL_TILES_OPTIMIZATION = 2;
+
+    // Идёт ли размер h1 * w1 в переборе прямоугольников раньше размера h2 * w2
+    bool isEarlierShape(int h1, int w1, int h2, int w2) {
+        if (AREA_ORDER_OPTIMIZATION == 2) {
+            return make_tuple(h1 * w1, h1 + w1, h1) < make_tuple(h2 * w2, h2 + w2, h2);
+        }
+        return make_pair(h1, w1) < make_pair(h2, w2);
+    }
+
+    // Граф периодических полосок длины length: горизонтальных (строк, у которых совпадают левый
+    // и правый край) или вертикальных (столбцов, у которых совпадают верхний и нижний край).
+    // Вершины - разрезы между соседними полосками (цвета вдоль разреза),
+    // полоска - ребро из разреза перед ней в разрез после неё.
+    // Полоску можно приставить к полоске <=> их рёбра идут подряд, поэтому
+    // период, в котором k полосок, есть <=> в графе есть замкнутый путь длины k
+    struct RowGraph {
+        int length;
+        bool vertical;
+        int numberOfCuts;
+        vector<Cell> rows; // полоски подряд по length клеток
+        vector<int> rowFrom; // разрез перед полоской (сверху для строк, слева для столбцов)
+        vector<int> rowTo; // разрез после полоски
+        vector<vector<int>> cutRows; // полоски, выходящие из разреза
+    };
+
+    // Булева матрица n * n, строки упакованы по 64 бита
+    // Для матрицы переходов графа полосок A: в A^k единица в (i, j) <=> есть путь из k полосок из разреза i в разрез j
+    struct BoolMatrix {
+        int n;
+        int words;
+        vector<unsigned long long> bits;
+
+        BoolMatrix(int _n) : n(_n), words((_n + 63) / 64), bits((size_t)_n * words, 0) {}
+
+        bool get(int i, int j) const {
+            return bits[(size_t)i * words + j / 64] >> (j % 64) & 1;
+        }
+
+        void set(int i, int j) {
+            bits[(size_t)i * words + j / 64] |= 1ULL << (j % 64);
+        }
+
+        // Строка i произведения - OR строк other, отмеченных в строке i (внутренний цикл векторизуется)
+        BoolMatrix multiply(const BoolMatrix& other) const {
+            BoolMatrix result(n);
+            for (int i = 0; i < n; ++i) {
+                unsigned long long* to = &result.bits[(size_t)i * words];
+                for (int word = 0; word < words; ++word) {
+                    for (unsigned long long mask = bits[(size_t)i * words + word]; mask; mask &= mask - 1) {
+                        const unsigned long long* from = &other.bits[(size_t)(word * 64 + __builtin_ctzll(mask)) * words];
+                        for (int j = 0; j < words; ++j) {
+                            to[j] |= from[j];
+                        }
+                    }
+                }
+            }
+            return result;
+        }
+
+        bool isZero() const {
+            for (unsigned long long word : bits) {
+                if (word != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Первая единица на диагонали произведения this * other без самого умножения:
+        // (this * other)[i][i] = 1 <=> есть j, что this[i][j] = other[j][i] = 1. false - если единиц нет
+        bool findProductDiagonal(const BoolMatrix& other, int& i, int& j) const {
+            for (i = 0; i < n; ++i) {
+                for (int word = 0; word < words; ++word) {
+                    for (unsigned long long mask = bits[(size_t)i * words + word]; mask; mask &= mask - 1) {
+                        j = word * 64 + __builtin_ctzll(mask);
+                        if (other.get(j, i)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+    };
+
+    // Всё состояние одного решателя. Контекст переиспользуется между вызовами solve():
+    // буферы сохраняют ёмкость, а чистится только та часть allTables, которую занял прошлый запуск.
+    // Контексты независимы, поэтому несколько штук могут работать одновременно в разных потоках.
+    // Внутри лежит allTables[N][N], так что контекст лучше создавать в куче или статически
+    class SolverContext {
+    public:
+        // Эта часть для внешнего доступа, запускает Solver на заданном наборе тайлов и выдаёт требуемые ответы
+        void solve(
+            const int _numberOfTiles,
+            const int _maximumSize,
+            const vector<vector<int>>& _tiles,
+            bool& _foundPeriod,
+            vector<vector<int>>& _minimumTilingRectangle,
+            vector<vector<int>>& _maximumTiledRectangle
+            ) {
+            numberOfTiles = _numberOfTiles;
+            maximumSize = _maximumSize;
+            assert(numberOfTiles < EMPTY_CELL);
+            setTiles(_tiles);
+            startBudget();
+            run();
+            _foundPeriod = foundPeriod;
+            _minimumTilingRectangle = minimumTilingRectangle;
+            _maximumTiledRectangle = maximumTiledRectangle;
+        }
+
+        // Бюджет одного solve() или findEarlierPeriod(): nodes - узлы перебора, cells - клетки, одновременно лежащие в allTables,
+        // 0 - без ограничения. Учитываются перебор прямоугольников и перебор на торе
+        void setBudget(long long nodes, long long cells) {
+            nodeBudget = nodes;
+            memoryBudget = cells;
+        }
+
+        // Последний запуск упёрся в бюджет, и его ответ ничего не значит
+        bool isOutOfBudget() const {
+            return outOfBudget;
+        }
+
+        // Ищет период на торах только тех размеров, которые перебор прямоугольников проходит раньше h * w.
+        // Если нашёлся - первый такой размер записывается в h и w, а период в _minimumTilingRectangle
+        bool findEarlierPeriod(
+            const int _numberOfTiles,
+            const int _maximumSize,
+            const vector<vector<int>>& _tiles,
+            int& h,
+            int& w,
+            vector<vector<int>>& _minimumTilingRectangle
+            ) {
+            numberOfTiles = _numberOfTiles;
+            maximumSize = _maximumSize;
+            assert(numberOfTiles < EMPTY_CELL);
+            setTiles(_tiles);
+            startBudget();
+            vector<pair<int, int>> shapes;
+            for (auto [shapeH, shapeW] : getShapes()) {
+                if (isEarlierShape(shapeH, shapeW, h, w)) {
+                    shapes.push_back({shapeH, shapeW});
+                }
+            }
+            sort(shapes.begin(), shapes.end(), [](const pair<int, int>& a, const pair<int, int>& b) {
+                return isEarlierShape(a.first, a.second, b.first, b.second);
+            });
+            for (auto [shapeH, shapeW] : shapes) {
+                torus.assign(shapeH * shapeW, EMPTY_CELL);
+                if (recTorus(shapeH, shapeW, 0)) {
+                    h = shapeH, w = shapeW;
+                    _minimumTilingRectangle = toMatrix({torus.data(), h, w});
+                    return true;
+                }
+                if (outOfBudget) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+    private:
+        int numberOfTiles; // количество тайлов
+        int maximumSize; // максимальный размер квадрата, который проверяем
+        vector<vector<int>> tiles; // заданный набор тайлов 
+
+        long long nodeBudget = 0;
+        long long memoryBudget = 0;
+        long long usedNodes;
+        long long usedCells;
+        bool outOfBudget;
+
+        void startBudget() {
+            usedNodes = 0;
+            usedCells = 0;
+            outOfBudget = false;
+        }
+
+        // false - бюджет узлов кончился, перебор надо сворачивать
+        bool spendNode() {
+            if (nodeBudget != 0 && ++usedNodes > nodeBudget) {
+                outOfBudget = true;
+            }
+            return !outOfBudget;
+        }
+
+        bool isSame(int type1, int type2, int dir1) {
+            return tiles[type1][dir1] == tiles[type2][dir1 ^ 2];
+        }
+
+        // Проверка замощённого прямоугольника - является ли он периодом
+        bool isTilingRectangle(const TableView& table) {
+            assert(table.n > 0);
+            int n = table.n;
+            assert(table.m > 0);
+            int m = table.m;
+
+            for (int x = 0; x < n; ++x) {
+                // table[x][0][3] != table[x][m - 1][1]
+                if (!isSame(table.get(x, 0), table.get(x, m - 1), 3)) {
+                    return false;
+                }
+            }
+
+            for (int y = 0; y < m; ++y) {
+                // table[0][y][0] != table[n - 1][y][2]
+                if (!isSame(table.get(0, y), table.get(n - 1, y), 0)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Проверка для точки на принадлежность bounding box
+        bool isInTable(const TableView& table, int x, int y) {
+            return x >= 0 && x < table.n && y >= 0 && y < table.m;
+        }
+
+        // Маски совместимости, строятся на solve() (или обновляются в setTiles)
+        // бит type в слове compatibleMask[dir][other * maskWords + type / 64] стоит, если тайл type
+        // можно поставить так, чтобы тайл other оказался его соседом в направлении dir
+        int maskWords;
+        vector<unsigned long long> compatibleMask[4];
+
+        void buildCompatibleMasks() {
+            maskWords = (numberOfTiles + 63) / 64;
+            for (int dir = 0; dir < 4; ++dir) {
+                compatibleMask[dir].assign(numberOfTiles * maskWords, 0);
+                for (int other = 0; other < numberOfTiles; ++other) {
+                    for (int type = 0; type < numberOfTiles; ++type) {
+                        if (isSame(type, other, dir)) {
+                            compatibleMask[dir][other * maskWords + type / 64] |= 1ULL << (type % 64);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Пересчитывает в масках совместимости всё, что касается тайлов changed: их строки и их биты в остальных строках
+        void updateCompatibleMasks(const vector<int>& changed) {
+            for (int dir = 0; dir < 4; ++dir) {
+                for (int type : changed) {
+                    for (int word = 0; word < maskWords; ++word) {
+                        compatibleMask[dir][type * maskWords + word] = 0;
+                    }
+                    for (int other = 0; other < numberOfTiles; ++other) {
+                        if (isSame(other, type, dir)) {
+                            compatibleMask[dir][type * maskWords + other / 64] |= 1ULL << (other % 64);
+                        }
+                        unsigned long long& word = compatibleMask[dir][other * maskWords + type / 64];
+                        if (isSame(type, other, dir)) {
+                            word |= 1ULL << (type % 64);
+                        } else {
+                            word &= ~(1ULL << (type % 64));
+                        }
+                    }
+                }
+            }
+        }
+
+        vector<int> changedTiles; // буфер setTiles
+
+        // Соседние наборы перебора обычно отличаются несколькими последними тайлами, поэтому
+        // при том же размере набора копируются и пересчитываются только поменявшиеся позиции
+        void setTiles(const vector<vector<int>>& _tiles) {
+            if (INCREMENTAL_TILES_OPTIMIZATION == 1 || tiles.size() != _tiles.size()) {
+                tiles = _tiles;
+                buildCompatibleMasks();
+                return;
+            }
+            changedTiles.clear();
+            for (int type = 0; type < numberOfTiles; ++type) {
+                if (tiles[type] != _tiles[type]) {
+                    tiles[type] = _tiles[type];
+                    changedTiles.push_back(type);
+                }
+            }
+            updateCompatibleMasks(changedTiles);
+        }
+
+        // Маска тайлов из слова word, которые можно поставить в данную точку
+        unsigned long long getCandidates(const TableView& table, int x, int y, int word) {
+            assert(isInTable(table, x, y));
+
+            unsigned long long candidates = ~0ULL;
+            if (word == maskWords - 1 && numberOfTiles % 64 != 0) {
+                candidates = (1ULL << (numberOfTiles % 64)) - 1;
+            }
+
+            for (int dir = 0; dir < 4 && candidates; ++dir) {
+                int nx = x + dx[dir];
+                int ny = y + dy[dir];
+                if (!isInTable(table, nx, ny)) continue;
+                if (table.get(nx, ny) == EMPTY_CELL) continue;
+                candidates &= compatibleMask[dir][table.get(nx, ny) * maskWords + word];
+            }
+
+            return candidates;
+        }
+
+        // конструкции вида: vector<vector<vector<vector<vector<int>>>>> - это смерть, 3 - тоже плохо, но не совсем смерть
+        // поэтому все прямоугольники h * w лежат подряд в одном буфере allTables[h][w]
+        vector<Cell> allTables[N][N];
+        vector<Cell> currentTable; // прямоугольник, который сейчас заполняет recTryToAdd
+        vector<vector<int>> minimumTilingRectangle;
+        vector<vector<int>> maximumTiledRectangle;
+        bool foundPeriod;
+        int usedSize = 0; // до какого размера заняты allTables с прошлого запуска
+        // последний в порядке по строкам (h, затем w) незамощаемый прямоугольник с w <= h:
+        // lastH = 0 - его нет, lastIndex = -1 - его нет или он уже скопирован в maximumTiledRectangle
+        int lastH, lastW, lastIndex;
+        // Открытая адресация по хешу границы: номера прямоугольников заполняемого allTables[h][w], -1 - пусто
+        vector<int> boundaryTable;
+        int numberOfBoundaries = 0;
+
+        // Хеш первой и последней строк, первого и последнего столбцов
+        unsigned long long getBoundaryHash(const TableView& table) {
+            unsigned long long hash = 14695981039346656037ULL;
+            for (int y = 0; y < table.m; ++y) {
+                hash = (hash ^ table.get(0, y)) * 1099511628211ULL;
+                hash = (hash ^ table.get(table.n - 1, y)) * 1099511628211ULL;
+            }
+            for (int x = 0; x < table.n; ++x) {
+                hash = (hash ^ table.get(x, 0)) * 1099511628211ULL;
+                hash = (hash ^ table.get(x, table.m - 1)) * 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        bool isSameBoundary(const TableView& table1, const TableView& table2) {
+            for (int y = 0; y < table1.m; ++y) {
+                if (table1.get(0, y) != table2.get(0, y) || table1.get(table1.n - 1, y) != table2.get(table2.n - 1, y)) {
+                    return false;
+                }
+            }
+            for (int x = 0; x < table1.n; ++x) {
+                if (table1.get(x, 0) != table2.get(x, 0) || table1.get(x, table1.m - 1) != table2.get(x, table2.m - 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void clearBoundaries() {
+            boundaryTable.assign(16, -1);
+            numberOfBoundaries = 0;
+        }
+
+        void insertBoundary(int h, int w, int index) {
+            size_t mask = boundaryTable.size() - 1;
+            size_t cell = getBoundaryHash(getTable(h, w, index)) & mask;
+            while (boundaryTable[cell] != -1) {
+                cell = (cell + 1) & mask;
+            }
+            boundaryTable[cell] = index;
+        }
+
+        // Есть ли в allTables[table.n][table.m] прямоугольник с такой же границей, если нет - запоминает,
+        // что table будет лежать там под номером countTables(table.n, table.m)
+        bool isKnownBoundary(const TableView& table) {
+            int h = table.n, w = table.m;
+            if (h < 3 || w < 3) {
+                return false; // внутренности нет, граница - весь прямоугольник
+            }
+            if (2 * (numberOfBoundaries + 1) > (int)boundaryTable.size()) {
+                boundaryTable.assign(2 * boundaryTable.size(), -1);
+                for (int index = 0; index < numberOfBoundaries; ++index) {
+                    insertBoundary(h, w, index);
+                }
+            }
+            size_t mask = boundaryTable.size() - 1;
+            size_t cell = getBoundaryHash(table) & mask;
+            while (boundaryTable[cell] != -1) {
+                if (isSameBoundary(getTable(h, w, boundaryTable[cell]), table)) {
+                    return true;
+                }
+                cell = (cell + 1) & mask;
+            }
+            boundaryTable[cell] = numberOfBoundaries++;
+            return false;
+        }
+
+        // Количество прямоугольников h * w (прямоугольник с нулевой стороной ровно один - пустой)
+        int countTables(int h, int w) {
+            if (h == 0 || w == 0) {
+                return 1;
+            }
+            return allTables[h][w].size() / (h * w);
+        }
+
+        TableView getTable(int h, int w, int index) {
+            return {allTables[h][w].data() + (size_t)index * h * w, h, w};
+        }
+
+        // Освободить память allTables[h][w], перед этим скопировав из него последний незамощаемый прямоугольник
+        void freeTables(int h, int w) {
+            if (lastIndex != -1 && lastH == h && lastW == w) {
+                maximumTiledRectangle = toMatrix(getTable(h, w, lastIndex));
+                lastIndex = -1;
+            }
+            usedCells -= allTables[h][w].size();
+            vector<Cell>().swap(allTables[h][w]);
+        }
+
+        // Обновить ответы замощённым прямоугольником
+        void relaxAnswers(const TableView& table) {
+            if (BOUNDARY_OPTIMIZATION == 2 && isKnownBoundary(table)) {
+                return;
+            }
+            if (isTilingRectangle(table)) {
+                minimumTilingRectangle = toMatrix(table);
+                foundPeriod = true;
+            } else if (ROLLING_FRONTIER_OPTIMIZATION == 2 && table.m <= table.n) {
+                // размеры могут строиться не по строкам (AREA_ORDER), а ответ - последний по строкам
+                if (table.n > lastH || (table.n == lastH && table.m >= lastW)) {
+                    lastH = table.n, lastW = table.m, lastIndex = countTables(table.n, table.m);
+                }
+            }
+            auto& bucket = allTables[table.n][table.m];
+            bucket.insert(bucket.end(), table.cells, table.cells + table.n * table.m);
+            usedCells += table.n * table.m;
+            if (memoryBudget != 0 && usedCells > memoryBudget) {
+                outOfBudget = true;
+            }
+        }
+
+        // Домены клеток полоски: stripDomains[i * maskWords + word] - тайлы из слова word,
+        // которые можно поставить в i-ю по порядку заполнения клетку так, чтобы полоска дозаполнилась
+        vector<unsigned long long> stripDomains;
+
+        // Порядок заполнения полоски: нижняя строка слева направо, потом правый столбец снизу вверх
+        int getStripIndex(const TableView& table, int x, int y) {
+            return x == table.n - 1 ? y : table.m - 1 + (table.n - 1 - x);
+        }
+
+        // В полоске каждая клетка соседствует только с предыдущей и следующей, поэтому одного прохода
+        // с конца хватает, чтобы в доменах остались ровно дозаполняемые тайлы: перебор не заходит в тупики,
+        // а клетки с одним вариантом проходятся без ветвления. false - полоску заполнить нельзя
+        bool buildStripDomains(const TableView& table) {
+            int length = table.n + table.m - 1;
+            stripDomains.assign(length * maskWords, 0);
+            for (int i = length - 1; i >= 0; --i) {
+                int x = i < table.m ? table.n - 1 : table.n - 1 - (i - (table.m - 1));
+                int y = i < table.m ? i : table.m - 1;
+                unsigned long long* domain = &stripDomains[i * maskWords];
+                if (i + 1 < length) {
+                    int dir = i + 1 < table.m ? 1 : 0; // следующая клетка справа или сверху
+                    const unsigned long long* nextDomain = &stripDomains[(i + 1) * maskWords];
+                    for (int word = 0; word < maskWords; ++word) {
+                        unsigned long long next = nextDomain[word];
+                        while (next) {
+                            int type = word * 64 + __builtin_ctzll(next);
+                            next &= next - 1;
+                            for (int to = 0; to < maskWords; ++to) {
+                                domain[to] |= compatibleMask[dir][type * maskWords + to];
+                            }
+                        }
+                    }
+                } else {
+                    for (int word = 0; word < maskWords; ++word) {
+                        domain[word] = ~0ULL;
+                    }
+                }
+                bool isEmpty = true;
+                for (int word = 0; word < maskWords; ++word) {
+                    domain[word] &= getCandidates(table, x, y, word);
+                    isEmpty &= domain[word] == 0;
+                }
+                if (isEmpty) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Рекурсивная штука пытается заполнить полоску от таблички (из EMPTY_CELL)
+        //  0  1 -1
+        //  1  2 -1
+        // -1 -1 -1
+        void recTryToAdd(const TableView& table, int x, int y) {
+            if (!spendNode()) {
+                return;
+            }
+            if (x == -1) {
+                relaxAnswers(table);
+            } else {
+                int m = table.m;
+
+                int nx = x, ny = y;
+                if (ny + 1 < m) {
+                    ++ny;
+                } else {
+                    --nx;
+                }
+
+                for (int word = 0; word < maskWords; ++word) {
+                    unsigned long long candidates = getCandidates(table, x, y, word);
+                    if (FORWARD_CHECKING_OPTIMIZATION == 2) {
+                        candidates &= stripDomains[getStripIndex(table, x, y) * maskWords + word];
+                    }
+                    while (candidates) {
+                        int type = word * 64 + __builtin_ctzll(candidates);
+                        candidates &= candidates - 1;
+
+                        currentTable[x * m + y] = type;
+                        recTryToAdd(table, nx, ny);
+                        currentTable[x * m + y] = EMPTY_CELL;
+                    }
+                }
+            }
+        }    
+
+        // Расширяет прямоугольник в нужную сторону и запускает рекурсию
+        void tryToAdd(const TableView& baseTable, int n, int m) {
+            currentTable.assign(n * m, EMPTY_CELL);
+            for (int x = 0; x < baseTable.n; ++x) {
+                for (int y = 0; y < baseTable.m; ++y) {
+                    currentTable[x * m + y] = baseTable.get(x, y);
+                }
+            }
+
+            TableView table = {currentTable.data(), n, m};
+            if (FORWARD_CHECKING_OPTIMIZATION == 2 && !buildStripDomains(table)) {
+                return;
+            }
+            recTryToAdd(table, n - 1, 0);
+        }
+
+        // Маска всех тайлов из слова word
+        unsigned long long getAllTilesMask(int word) {
+            if (word == maskWords - 1 && numberOfTiles % 64 != 0) {
+                return (1ULL << (numberOfTiles % 64)) - 1;
+            }
+            return ~0ULL;
+        }
+
+        int getCut(RowGraph& graph, map<vector<int>, int>& cuts, const vector<int>& colors) {
+            auto it = cuts.find(colors);
+            if (it != cuts.end()) {
+                return it->second;
+            }
+            cuts[colors] = graph.numberOfCuts;
+            graph.cutRows.push_back({});
+            return graph.numberOfCuts++;
+        }
+
+        // Перебор полосок от первой клетки к последней
+        void recGenRows(RowGraph& graph, map<vector<int>, int>& cuts, vector<Cell>& row, int i) {
+            int length = graph.length;
+            int alongDir = graph.vertical ? 2 : 1; // куда идёт полоска
+            int fromDir = graph.vertical ? 3 : 0; // сторона, смотрящая на предыдущую полоску
+            if (i == length) {
+                if (!isSame(row[length - 1], row[0], alongDir)) {
+                    return;
+                }
+                vector<int> fromColors(length), toColors(length);
+                for (int j = 0; j < length; ++j) {
+                    fromColors[j] = tiles[row[j]][fromDir];
+                    toColors[j] = tiles[row[j]][fromDir ^ 2];
+                }
+                int from = getCut(graph, cuts, fromColors);
+                int to = getCut(graph, cuts, toColors);
+                graph.cutRows[from].push_back(graph.rowFrom.size());
+                graph.rowFrom.push_back(from);
+                graph.rowTo.push_back(to);
+                graph.rows.insert(graph.rows.end(), row.begin(), row.end());
+            } else {
+                for (int word = 0; word < maskWords; ++word) {
+                    unsigned long long candidates = getAllTilesMask(word);
+                    if (i > 0) {
+                        // предыдущая клетка полоски
+                        candidates &= compatibleMask[alongDir ^ 2][row[i - 1] * maskWords + word];
+                    }
+                    while (candidates) {
+                        row[i] = word * 64 + __builtin_ctzll(candidates);
+                        candidates &= candidates - 1;
+                        recGenRows(graph, cuts, row, i + 1);
+                    }
+                }
+            }
+        }
+
+        RowGraph buildRowGraph(int length, bool vertical) {
+            RowGraph graph;
+            graph.length = length;
+            graph.vertical = vertical;
+            graph.numberOfCuts = 0;
+            map<vector<int>, int> cuts;
+            vector<Cell> row(length);
+            recGenRows(graph, cuts, row, 0);
+            return graph;
+        }
+
+        // Компоненты сильной связности (Тарьян), нужны чтобы искать циклы только внутри компонент
+        void tarjan(const RowGraph& graph, int v, int& timer, vector<int>& tin, vector<int>& low, vector<int>& stack, vector<bool>& inStack, vector<int>& component, int& numberOfComponents) {
+            tin[v] = low[v] = timer++;
+            stack.push_back(v);
+            inStack[v] = true;
+            for (int row : graph.cutRows[v]) {
+                int u = graph.rowTo[row];
+                if (tin[u] == -1) {
+                    tarjan(graph, u, timer, tin, low, stack, inStack, component, numberOfComponents);
+                    low[v] = min(low[v], low[u]);
+                } else if (inStack[u]) {
+                    low[v] = min(low[v], tin[u]);
+                }
+            }
+            if (low[v] == tin[v]) {
+                while (true) {
+                    int u = stack.back();
+                    stack.pop_back();
+                    inStack[u] = false;
+                    component[u] = numberOfComponents;
+                    if (u == v) break;
+                }
+                ++numberOfComponents;
+            }
+        }
+
+        // Кратчайший замкнутый путь длины не больше maximumLength
+        // возвращает полоски цикла по порядку, пустой вектор - если такого нет
+        vector<int> findShortestCycle(const RowGraph& graph, int maximumLength) {
+            int n = graph.numberOfCuts;
+            int timer = 0, numberOfComponents = 0;
+            vector<int> tin(n, -1), low(n), stack, component(n);
+            vector<bool> inStack(n, false);
+            for (int v = 0; v < n; ++v) {
+                if (tin[v] == -1) {
+                    tarjan(graph, v, timer, tin, low, stack, inStack, component, numberOfComponents);
+                }
+            }
+
+            vector<int> bestCycle;
+            vector<int> dist(n, -1), parentRow(n, -1), queue;
+            for (int start = 0; start < n; ++start) {
+                // bfs из start внутри его компоненты
+                queue.assign(1, start);
+                dist[start] = 0;
+                int lastRow = -1;
+                for (size_t i = 0; i < queue.size() && lastRow == -1; ++i) {
+                    int v = queue[i];
+                    if (dist[v] + 1 > maximumLength) break;
+                    for (int row : graph.cutRows[v]) {
+                        int u = graph.rowTo[row];
+                        if (component[u] != component[start]) continue;
+                        if (u == start) {
+                            lastRow = row;
+                            break;
+                        }
+                        if (dist[u] != -1) continue;
+                        dist[u] = dist[v] + 1;
+                        parentRow[u] = row;
+                        queue.push_back(u);
+                    }
+                }
+                if (lastRow != -1) {
+                    vector<int> cycle = {lastRow};
+                    for (int v = graph.rowFrom[lastRow]; v != start; v = graph.rowFrom[parentRow[v]]) {
+                        cycle.push_back(parentRow[v]);
+                    }
+                    reverse(cycle.begin(), cycle.end());
+                    bestCycle = cycle;
+                    maximumLength = cycle.size() - 1;
+                }
+                for (int v : queue) {
+                    dist[v] = -1;
+                }
+            }
+            return bestCycle;
+        }
+
+        // Поиск минимального периода через граф полосок. Высоты перебираются по возрастанию,
+        // для высоты h строится граф столбцов высоты h и в нём ищется кратчайший цикл - это
+        // минимальная ширина. Первая высота, где цикл нашёлся, и даёт ответ (как в переборе прямоугольников)
+        void runRowGraph() {
+            foundPeriod = false;
+            for (int h = 1; h <= maximumSize && !foundPeriod; ++h) {
+                RowGraph graph = buildRowGraph(h, true);
+                vector<int> cycle = findShortestCycle(graph, maximumSize);
+                if (cycle.empty()) {
+                    continue;
+                }
+                setPeriodFromColumns(graph, cycle);
+            }
+        }
+
+        // Период из замкнутого пути по графу столбцов: столбцы пути идут слева направо
+        void setPeriodFromColumns(const RowGraph& graph, const vector<int>& cycle) {
+            int h = graph.length;
+            int w = cycle.size();
+            minimumTilingRectangle.assign(h, vector<int>(w));
+            for (int x = 0; x < h; ++x) {
+                for (int y = 0; y < w; ++y) {
+                    minimumTilingRectangle[x][y] = graph.rows[cycle[y] * h + x];
+                }
+            }
+            foundPeriod = true;
+        }
+
+        // Дописывает в walk путь из length полосок из разреза from в разрез to (powers[k] - степени матрицы переходов):
+        // из v идём по полоске в u, из которого есть путь нужной длины в to
+        void appendWalk(const RowGraph& graph, const vector<BoolMatrix>& powers, int from, int to, int length, vector<int>& walk) {
+            for (int v = from; length > 0; --length) {
+                int next = -1;
+                for (int row : graph.cutRows[v]) {
+                    if (powers[length - 1].get(graph.rowTo[row], to)) {
+                        next = row;
+                        break;
+                    }
+                }
+                assert(next != -1);
+                walk.push_back(next);
+                v = graph.rowTo[next];
+            }
+        }
+
+        // Поиск минимального периода степенями матрицы переходов A графа столбцов высоты h:
+        // период h * w есть <=> на диагонали A^w есть единица. A^w = A^((w + 1) / 2) * A^(w / 2), а диагональ
+        // произведения проверяется без умножения, так что степени нужны только до (maximumSize + 1) / 2.
+        // Первая подходящая ширина - минимальная. Высоты по возрастанию, как в runRowGraph
+        void runMatrixPowers() {
+            foundPeriod = false;
+            for (int h = 1; h <= maximumSize && !foundPeriod; ++h) {
+                RowGraph graph = buildRowGraph(h, true);
+                int n = graph.numberOfCuts;
+                vector<BoolMatrix> powers(2, BoolMatrix(n));
+                for (int v = 0; v < n; ++v) {
+                    powers[0].set(v, v);
+                }
+                for (int row = 0; row < (int)graph.rowFrom.size(); ++row) {
+                    powers[1].set(graph.rowFrom[row], graph.rowTo[row]);
+                }
+                for (int w = 1; w <= maximumSize; ++w) {
+                    int leftLength = (w + 1) / 2;
+                    int rightLength = w / 2;
+                    if ((int)powers.size() <= leftLength) {
+                        powers.push_back(powers.back().multiply(powers[1]));
+                    }
+                    if (powers[leftLength].isZero()) {
+                        break; // путей такой длины нет, длиннее тоже не будет
+                    }
+                    int start, middle;
+                    if (!powers[leftLength].findProductDiagonal(powers[rightLength], start, middle)) {
+                        continue;
+                    }
+                    vector<int> cycle;
+                    appendWalk(graph, powers, start, middle, leftLength, cycle);
+                    appendWalk(graph, powers, middle, start, rightLength, cycle);
+                    setPeriodFromColumns(graph, cycle);
+                    break;
+                }
+            }
+        }
+
+        // Перебор прямоугольников по возрастанию размера
+        // Размеры прямоугольников, которые перебирает runRectangles(), по строкам
+        vector<pair<int, int>> getShapes() {
+            vector<pair<int, int>> shapes;
+            for (int h = 1; h <= maximumSize; ++h) {
+                for (int w = min(h, FIRST_SQUARE_OPTIMIZATION); w <= (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h); ++w) {
+                    shapes.push_back({h, w});
+                }
+            }
+            return shapes;
+        }
+
+        // Достраивает allTables[h][w] из allTables[h - 1][w - 1]
+        void buildShape(int h, int w) {
+            clearBoundaries();
+            for (int index = 0; index < countTables(h - 1, w - 1); ++index) {
+                if (foundPeriod || outOfBudget) {
+                    break;
+                } else {
+                    tryToAdd(getTable(h - 1, w - 1, index), h, w);
+                }
+            }
+            if (ROLLING_FRONTIER_OPTIMIZATION == 2) {
+                freeTables(h - 1, w - 1);
+            }
+        }
+
+        // Размеры из shapes по возрастанию площади, при равной - периметра. Размер попадает в очередь,
+        // когда построена его основа allTables[h - 1][w - 1] или основы нет среди shapes, так что основа
+        // всегда готова, и каждая корзина по-прежнему нужна только следующему размеру по диагонали.
+        // За пустым размером его продолжения не строятся
+        void runAreaOrder(const vector<pair<int, int>>& shapes) {
+            vector<vector<char>> isShape(maximumSize + 2, vector<char>(maximumSize + 2, 0));
+            for (auto [h, w] : shapes) {
+                isShape[h][w] = 1;
+            }
+            priority_queue<tuple<int, int, int>, vector<tuple<int, int, int>>, greater<tuple<int, int, int>>> order;
+            for (auto [h, w] : shapes) {
+                if (!isShape[h - 1][w - 1]) {
+                    order.push({h * w, h + w, h});
+                }
+            }
+            while (!order.empty() && !foundPeriod && !outOfBudget) {
+                auto [area, perimeter, h] = order.top();
+                order.pop();
+                int w = area / h;
+                buildShape(h, w);
+                if (countTables(h, w) > 0 && isShape[h + 1][w + 1]) {
+                    order.push({(h + 1) * (w + 1), h + w + 2, h + 1});
+                }
+            }
+        }
+
+        void runRectangles() {
+            for (int h = 0; h <= usedSize; ++h) {
+                for (int w = 0; w <= usedSize; ++w) {
+                    allTables[h][w].clear();
+                }
+            } 
+            usedSize = maximumSize;
+
+            foundPeriod = false;
+            maximumTiledRectangle.clear();
+            lastH = 0, lastW = 0, lastIndex = -1;
+
+            vector<pair<int, int>> shapes = getShapes();
+            if (AREA_ORDER_OPTIMIZATION == 2) {
+                runAreaOrder(shapes);
+            } else {
+                for (auto [h, w] : shapes) {
+                    if (foundPeriod || outOfBudget) {
+                        break;
+                    }
+                    buildShape(h, w);
+                }
+            }
+
+            if (ROLLING_FRONTIER_OPTIMIZATION == 1) {
+                lastIndex = -1;
+                for (int h = 1; h <= maximumSize; ++h) {
+                    for (int w = 1; w <= h; ++w) {
+                        for (int index = 0; index < countTables(h, w); ++index) {
+                            if (!isTilingRectangle(getTable(h, w, index))) {
+                                lastIndex = index, lastH = h, lastW = w;
+                            }
+                        }
+                    }
+                }
+            }
+            if (lastIndex != -1) {
+                maximumTiledRectangle = toMatrix(getTable(lastH, lastW, lastIndex));
+            }
+        }
+
+        vector<Cell> torus; // тор h * w, который заполняет recTorus
+
+        // Маска тайлов из слова word, которые можно поставить в клетку тора (соседи через край тоже соседи)
+        unsigned long long getTorusCandidates(int h, int w, int x, int y, int word) {
+            unsigned long long candidates = getAllTilesMask(word);
+            for (int dir = 0; dir < 4 && candidates; ++dir) {
+                int nx = (x + dx[dir] + h) % h;
+                int ny = (y + dy[dir] + w) % w;
+                if (nx == x && ny == y) {
+                    // при h == 1 или w == 1 клетка соседствует сама с собой
+                    for (unsigned long long rest = candidates; rest; rest &= rest - 1) {
+                        int type = word * 64 + __builtin_ctzll(rest);
+                        if (!isSame(type, type, dir)) {
+                            candidates &= ~(1ULL << (type % 64));
+                        }
+                    }
+                } else if (torus[nx * w + ny] != EMPTY_CELL) {
+                    candidates &= compatibleMask[dir][torus[nx * w + ny] * maskWords + word];
+                }
+            }
+            return candidates;
+        }
+
+        // Заполняет тор, каждый раз выбирая пустую клетку с наименьшим числом вариантов
+        bool recTorus(int h, int w, int filled) {
+            if (!spendNode()) {
+                return false;
+            }
+            if (filled == h * w) {
+                return true;
+            }
+            int bestCell = -1, bestCount = numberOfTiles + 1;
+            for (int cell = 0; cell < h * w && bestCount > 1; ++cell) {
+                if (torus[cell] != EMPTY_CELL) {
+                    continue;
+                }
+                int count = 0;
+                for (int word = 0; word < maskWords; ++word) {
+                    count += __builtin_popcountll(getTorusCandidates(h, w, cell / w, cell % w, word));
+                }
+                if (count == 0) {
+                    return false;
+                }
+                if (count < bestCount) {
+                    bestCell = cell, bestCount = count;
+                }
+            }
+
+            for (int word = 0; word < maskWords; ++word) {
+                unsigned long long candidates = getTorusCandidates(h, w, bestCell / w, bestCell % w, word);
+                while (candidates) {
+                    int type = word * 64 + __builtin_ctzll(candidates);
+                    candidates &= candidates - 1;
+
+                    torus[bestCell] = type;
+                    if (recTorus(h, w, filled + 1)) {
+                        return true;
+                    }
+                    torus[bestCell] = EMPTY_CELL;
+                }
+            }
+            return false;
+        }
+
+        // Периоды по возрастанию размера, каждый ищется сразу на торе h * w,
+        // поэтому прямоугольники без периода не строятся и не хранятся
+        void runTorus() {
+            foundPeriod = false;
+            for (int h = 1; h <= maximumSize && !foundPeriod && !outOfBudget; ++h) {
+                for (int w = min(h, FIRST_SQUARE_OPTIMIZATION); w <= (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h) && !foundPeriod && !outOfBudget; ++w) {
+                    torus.assign(h * w, EMPTY_CELL);
+                    if (recTorus(h, w, 0)) {
+                        foundPeriod = true;
+                        minimumTilingRectangle = toMatrix({torus.data(), h, w});
+                    }
+                }
+            }
+        }
+
+        // main
+        void run() {
+            if (PERIOD_SEARCH_ENGINE != 1) {
+                if (PERIOD_SEARCH_ENGINE == 2) {
+                    runRowGraph();
+                } else if (PERIOD_SEARCH_ENGINE == 3) {
+                    runTorus();
+                } else {
+                    runMatrixPowers();
+                }
+                if (foundPeriod || outOfBudget || maximumSize >= N) {
+                    return;
+                }
+            }
+            runRectangles();
+        }
+    };
+};
+
+int numberOfTiles;
+int numberOfColors;
+int maximumSize;
+
+// Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
+const int N = 123;    
+
+void inputParameters() {
+    cout << "input number of tiles, number of colors (on both sides), maximum size for check" << endl;
+    cin >> numberOfTiles >> numberOfColors >> maximumSize;
+    assert(maximumSize < N);
+}
+
+// С учётом весов классов симметрии, поэтому long long
+atomic<long long> numberOfAllSets;
+atomic<long long> numberOfSolvedSets; // сколько раз реально запускали Solver
+atomic<long long> numberOfCachedSets; // сколько ответов взято из кэша
+atomic<long long> numberOfInferredSets; // сколько ответов выведено из периодов поднаборов
+atomic<long long> numberOfUndecidedSets; // сколько наборов не решилось и с последним бюджетом
+const int NUMBER_OF_FILTERS = 3;
+atomic<long long> numberOfFilteredSets[NUMBER_OF_FILTERS]; // сколько наборов первым отбросил каждый фильтр
+
+atomic<long long> numberOfAllTilingSets;
+atomic<long long> numberOfAllNonTilingSets;
+
+void writeMatrix(ostream& out, const vector<vector<int>>& matrix) {
+    out << matrix.size() << " " << (matrix.empty() ? 0 : matrix[0].size()) << "\n";
+    for (const auto& row : matrix) {
+        for (int value : row) {
+            out << value << " ";
+        }
+        out << "\n";
+    }
+}
+
+bool readMatrix(istream& in, vector<vector<int>>& matrix) {
+    int n, m;
+    if (!(in >> n >> m) || n < 0 || m < 0) {
+        return false;
+    }
+    matrix.assign(n, vector<int>(m));
+    for (auto& row : matrix) {
+        for (int& value : row) {
+            if (!(in >> value)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Гистограммы и примеры наборов
+// При параллельном переборе у каждого потока своя статистика, в конце они складываются в results
+struct Statistics {
+    long long numberOfTilingSets[N][N];
+    long long numberOfNonTilingSets[N][N];
+
+    vector<vector<int>> sampleTilingSet[N][N];
+    vector<vector<int>> sampleTilingRectangle[N][N];
+    long long sampleTilingOrder[N][N]; // ранг набора-примера
+
+    vector<vector<int>> sampleNonTilingSet[N][N];
+    vector<vector<int>> sampleNonTilingRectangle[N][N];
+    long long sampleNonTilingOrder[N][N];
+
+    void clear() {
+        for (int h = 0; h < N; ++h) {
+            for (int w = 0; w < N; ++w) {
+                numberOfTilingSets[h][w] = 0;
+                numberOfNonTilingSets[h][w] = 0;
+
+                sampleTilingSet[h][w] = {};
+                sampleTilingRectangle[h][w] = {};
+                sampleTilingOrder[h][w] = 0;
+
+                sampleNonTilingSet[h][w] = {};
+                sampleNonTilingRectangle[h][w] = {};
+                sampleNonTilingOrder[h][w] = 0;
+            }
+        }
+    }
+
+    // Текстовый формат для контрольных точек: непустые ячейки гистограмм вместе с примерами, в конце -1
+    void save(ostream& out) const {
+        for (int h = 0; h < N; ++h) {
+            for (int w = 0; w < N; ++w) {
+                if (numberOfTilingSets[h][w] != 0) {
+                    out << 0 << " " << h << " " << w << " " << numberOfTilingSets[h][w] << " " << sampleTilingOrder[h][w] << "\n";
+                    writeMatrix(out, sampleTilingSet[h][w]);
+                    writeMatrix(out, sampleTilingRectangle[h][w]);
+                }
+                if (numberOfNonTilingSets[h][w] != 0) {
+                    out << 1 << " " << h << " " << w << " " << numberOfNonTilingSets[h][w] << " " << sampleNonTilingOrder[h][w] << "\n";
+                    writeMatrix(out, sampleNonTilingSet[h][w]);
+                    writeMatrix(out, sampleNonTilingRectangle[h][w]);
+                }
+            }
+        }
+        out << -1 << "\n";
+    }
+
+    bool load(istream& in) {
+        clear();
+        while (true) {
+            int type;
+            if (!(in >> type)) {
+                return false;
+            }
+            if (type == -1) {
+                return true;
+            }
+            int h, w;
+            long long count, order;
+            if (!(in >> h >> w >> count >> order) || type < 0 || type > 1 || h < 0 || h >= N || w < 0 || w >= N) {
+                return false;
+            }
+            if (type == 0) {
+                numberOfTilingSets[h][w] = count;
+                sampleTilingOrder[h][w] = order;
+                if (!readMatrix(in, sampleTilingSet[h][w]) || !readMatrix(in, sampleTilingRectangle[h][w])) {
+                    return false;
+                }
+            } else {
+                numberOfNonTilingSets[h][w] = count;
+                sampleNonTilingOrder[h][w] = order;
+                if (!readMatrix(in, sampleNonTilingSet[h][w]) || !readMatrix(in, sampleNonTilingRectangle[h][w])) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Добавить чужую статистику, из двух примеров остаётся тот, что раньше в последовательном переборе
+    void merge(const Statistics& other) {
+        for (int h = 0; h < N; ++h) {
+            for (int w = 0; w < N; ++w) {
+                if (other.numberOfTilingSets[h][w] != 0) {
+                    if (numberOfTilingSets[h][w] == 0 || other.sampleTilingOrder[h][w] < sampleTilingOrder[h][w]) {
+                        sampleTilingSet[h][w] = other.sampleTilingSet[h][w];
+                        sampleTilingRectangle[h][w] = other.sampleTilingRectangle[h][w];
+                        sampleTilingOrder[h][w] = other.sampleTilingOrder[h][w];
+                    }
+                    numberOfTilingSets[h][w] += other.numberOfTilingSets[h][w];
+                }
+                if (other.numberOfNonTilingSets[h][w] != 0) {
+                    if (numberOfNonTilingSets[h][w] == 0 || other.sampleNonTilingOrder[h][w] < sampleNonTilingOrder[h][w]) {
+                        sampleNonTilingSet[h][w] = other.sampleNonTilingSet[h][w];
+                        sampleNonTilingRectangle[h][w] = other.sampleNonTilingRectangle[h][w];
+                        sampleNonTilingOrder[h][w] = other.sampleNonTilingOrder[h][w];
+                    }
+                    numberOfNonTilingSets[h][w] += other.numberOfNonTilingSets[h][w];
+                }
+            }
+        }
+    }
+};
+
+Statistics results;
+
+// Префиксное дерево свидетелей периода: путь - отсортированные коды тайлов, из которых состоит найденный период,
+// в конце пути - размер этого периода. Любое надмножество свидетеля замощает плоскость тем же периодом
+struct WitnessTrie {
+    struct Node {
+        map<int, int> children;
+        int h = 0; // 0 - здесь свидетель не кончается
+        int w = 0;
+    };
+    vector<Node> nodes = vector<Node>(1);
+
+    void insert(const vector<int>& codes, int h, int w) {
+        int node = 0;
+        for (int code : codes) {
+            auto it = nodes[node].children.find(code);
+            if (it == nodes[node].children.end()) {
+                it = nodes[node].children.emplace(code, nodes.size()).first;
+                nodes.emplace_back();
+            }
+            node = it->second;
+        }
+        if (nodes[node].h == 0 || Solver::isEarlierShape(h, w, nodes[node].h, nodes[node].w)) {
+            nodes[node].h = h, nodes[node].w = w;
+        }
+    }
+
+    // Самый ранний в порядке перебора размер среди свидетелей, которые целиком лежат в codes (отсортированных)
+    bool findSubset(const vector<int>& codes, int& h, int& w) const {
+        h = 0, w = 0;
+        recFindSubset(codes, 0, 0, h, w);
+        return h != 0;
+    }
+
+private:
+    void recFindSubset(const vector<int>& codes, int node, int pos, int& h, int& w) const {
+        if (nodes[node].h != 0 && (h == 0 || Solver::isEarlierShape(nodes[node].h, nodes[node].w, h, w))) {
+            h = nodes[node].h, w = nodes[node].w;
+        }
+        for (int i = pos; i < (int)codes.size(); ++i) {
+            auto it = nodes[node].children.find(codes[i]);
+            if (it != nodes[node].children.end()) {
+                recFindSubset(codes, it->second, i + 1, h, w);
+            }
+        }
+    }
+};
+
+// Ограничивать каждый запуск Solver-а бюджетом (1 - нет, 2 - да)
+// Набор, который упёрся в бюджет, не считается ни замощающим, ни незамощающим, а откладывается.
+// После перебора отложенные наборы перепроверяются RETRY_ROUNDS раз на всех ядрах, бюджет каждый раз
+// растёт в BUDGET_GROWTH раз; оставшиеся выводятся как нерешённые
+const int BUDGET_OPTIMIZATION = 1;
+const long long NODE_BUDGET = 1 << 24; // узлы перебора
+const long long MEMORY_BUDGET = 1 << 27; // клетки в allTables
+const int BUDGET_GROWTH = 4;
+const int RETRY_ROUNDS = 3;
+
+// Отложенный набор вместе с рангом и весом, с которыми он попадёт в статистику
+struct UndecidedSet {
+    vector<vector<int>> tiles;
+    long long order;
+    long long weight;
+};
+
+vector<UndecidedSet> undecidedSets;
+
+// Всё, что нужно одному потоку перебора: свой решатель, своя статистика, свои свидетели периодов
+// и свои отложенные наборы
+struct Worker {
+    Solver::SolverContext solver;
+    Statistics statistics;
+    WitnessTrie witnesses;
+    vector<UndecidedSet> undecided;
+
+    Worker(long long nodeBudget = NODE_BUDGET, long long memoryBudget = MEMORY_BUDGET) {
+        statistics.clear();
+        if (BUDGET_OPTIMIZATION == 2) {
+            solver.setBudget(nodeBudget, memoryBudget);
+        }
+    }
+
+    // Статистику - в общую, отложенные наборы - в общую очередь
+    void mergeInto(Statistics& total) {
+        total.merge(statistics);
+        undecidedSets.insert(undecidedSets.end(), undecided.begin(), undecided.end());
+        undecided.clear();
+    }
+};
+
+// Инициализирует все массивы и счётчики
+void initData() {
+    numberOfAllSets = 0;
+    numberOfSolvedSets = 0;
+    numberOfCachedSets = 0;
+    numberOfInferredSets = 0;
+    numberOfUndecidedSets = 0;
+    for (auto& filtered : numberOfFilteredSets) {
+        filtered = 0;
+    }
+
+    numberOfAllTilingSets = 0;
+    numberOfAllNonTilingSets = 0;
+
+    results.clear();
+}
+
+const int numberOfSides = 4;
+vector<vector<int>> allTiles;
+
+// Генерация всех тайлов с заданными цветами
+void genAllTiles(vector<int> tile) {
+    if (tile.size() == numberOfSides) {
+        allTiles.push_back(tile);
+    } else {
+        tile.push_back(0);
+        for (int i = 0; i < numberOfColors; ++i) {
+            tile[tile.size() - 1] = i;
+            genAllTiles(tile);
+        } 
+    }
+}
+
+// Первый тайл в наборе (0 0 <=1 <=1) (1 - нет, 2 - да)
+// Грубая замена SYMMETRY_OPTIMIZATION, вместе с ней включать нельзя
+const int FIRST_OPTIMUM_TILE_OPTIMIZATION = 1; 
+
+// Проверять только один набор из каждого класса симметрии (1 - нет, 2 - да)
+// Симметрии - перестановки цветов вместе с отражениями (слева направо, сверху вниз, поворот на 180):
+// они не меняют ни размеры периодов, ни размеры замощаемых прямоугольников, поэтому
+// канонический (минимальный в классе) набор учитывается в статистике с весом = размер класса.
+// Поворот на 90 и транспонирование меняют h и w местами, а минимальный период ищется по возрастанию h,
+// так что ответ для повёрнутого набора из ответа для исходного не получается - такие наборы не склеиваются
+const int SYMMETRY_OPTIMIZATION = 2;
+
+static_assert(!(FIRST_OPTIMUM_TILE_OPTIMIZATION == 2 && SYMMETRY_OPTIMIZATION == 2), "FIRST_OPTIMUM_TILE_OPTIMIZATION breaks symmetry weights");
+
+// symmetries[g][код тайла] - код образа тайла при симметрии g, код тайла - его номер в allTiles
+vector<vector<int>> symmetries;
+
+int getTileCode(const vector<int>& tile) {
+    int code = 0;
+    for (int side : tile) {
+        code = code * numberOfColors + side;
+    }
+    return code;
+}
+
+void genSymmetries() {
+    vector<int> colors(numberOfColors);
+    for (int i = 0; i < numberOfColors; ++i) {
+        colors[i] = i;
+    }
+    do {
+        // flip & 1 - отражение слева направо, flip & 2 - сверху вниз
+        for (int flip = 0; flip < 4; ++flip) {
+            vector<int> image(allTiles.size());
+            for (int code = 0; code < (int)allTiles.size(); ++code) {
+                vector<int> tile = allTiles[code];
+                if (flip & 1) {
+                    swap(tile[1], tile[3]);
+                }
+                if (flip & 2) {
+                    swap(tile[0], tile[2]);
+                }
+                for (auto& side : tile) {
+                    side = colors[side];
+                }
+                image[code] = getTileCode(tile);
+            }
+            symmetries.push_back(image);
+        }
+    } while (next_permutation(colors.begin(), colors.end()));
+}
+
+// Размер класса симметрии набора или 0, если набор не минимальный в своём классе
+long long getSymmetryWeight(const vector<vector<int>>& tiles) {
+    vector<int> codes;
+    for (const auto& tile : tiles) {
+        codes.push_back(getTileCode(tile));
+    }
+    sort(codes.begin(), codes.end());
+    int stabilizer = 0;
+    vector<int> image(codes.size());
+    for (const auto& symmetry : symmetries) {
+        for (int i = 0; i < (int)codes.size(); ++i) {
+            image[i] = symmetry[codes[i]];
+        }
+        sort(image.begin(), image.end());
+        if (image < codes) {
+            return 0;
+        } else if (image == codes) {
+            ++stabilizer;
+        }
+    }
+    return symmetries.size() / stabilizer;
+}
+
+// Кэш результатов на диске (1 - нет, 2 - да)
+// Общий для всех запусков и процессов: ключ - канонический набор тайлов (цвета сторон, а не номера
+// в allTiles, поэтому кэш переживает смену numberOfColors), значение - ответ Solver-а при данном maximumSize
+const int RESULT_CACHE_OPTIMIZATION = 1;
+const char* RESULT_CACHE_FILE = "brute_force_cache.bin";
+const uint64_t RESULT_CACHE_CAPACITY = 1 << 22; // число ячеек при создании файла
+const int MAX_CACHED_TILES = 16; // наборы больше не кэшируются
 
-    // Перебор направлений
-    // x - столбцы, y - строки
-    // противоположный - ^ 2
-    const vector<int> dx = {-1, 0, 1, 0}; // up, right, down, left
-    const vector<int> dy = {0, 1, 0, -1};  
+// Ячейка открытой адресации, пишется один раз и дальше не меняется
+struct CacheEntry {
+    uint64_t hash; // 0 - ячейка свободна
+    uint8_t numberOfTiles;
+    uint8_t tiles[MAX_CACHED_TILES][4];
+    uint8_t maximumSize;
+    uint8_t foundPeriod;
+    uint8_t h; // размер минимального периода или максимального замощённого прямоугольника
+    uint8_t w;
+    uint8_t ready; // ячейка дописана, её можно читать
+};
 
-    bool isSame(int type1, int type2, int dir1) {
-        return tiles[type1][dir1] == tiles[type2][dir1 ^ 2];
-    }
+struct CacheHeader {
+    uint64_t magic;
+    uint64_t configuration; // ключи, от которых зависят найденные h и w, см. getCacheConfiguration()
+    uint64_t capacity;
+    uint64_t numberOfEntries;
+};
 
-    // Проверка замощённого прямоугольника - является ли он периодом
-    bool isTilingRectangle(const vector<vector<int>>& table) {
-        assert(!table.empty());
-        int n = table.size();
-        assert(!table[0].empty());
-        int m = table[0].size();
+const uint64_t RESULT_CACHE_MAGIC = 0x32656863615467ULL;
 
-        for (int x = 0; x < n; ++x) {
-            // table[x][0][3] != table[x][m - 1][1]
-            if (!isSame(table[x][0], table[x][m - 1], 3)) {
-                return false;
-            }
-        }
+// Размер ответа зависит не только от набора и maximumSize, но и от порядка перебора размеров,
+// поэтому кэш, записанный с другими ключами, не открывается
+uint64_t getCacheConfiguration() {
+    return Solver::PERIOD_SEARCH_ENGINE |
+        Solver::FIRST_SQUARE_OPTIMIZATION << 8 |
+        Solver::LEXICOGRAPHIC_OPTIMIZATION << 16 |
+        Solver::AREA_ORDER_OPTIMIZATION << 24;
+}
 
-        for (int y = 0; y < m; ++y) {
-            // table[0][y][0] != table[n - 1][y][2]
-            if (!isSame(table[0][y], table[n - 1][y], 0)) {
+// Хеш-таблица в файле, отображённом в память. Читатели ничего не блокируют: ячейка становится
+// видна только после записи ready. Писатели (потоки и другие процессы) берут mutex и flock на файл
+class ResultCache {
+public:
+    bool open(const char* fileName) {
+        fd = ::open(fileName, O_RDWR | O_CREAT, 0644);
+        if (fd == -1) {
+            return false;
+        }
+        flock(fd, LOCK_EX);
+        struct stat fileStat;
+        fstat(fd, &fileStat);
+        if (fileStat.st_size == 0) {
+            CacheHeader header = {RESULT_CACHE_MAGIC, getCacheConfiguration(), RESULT_CACHE_CAPACITY, 0};
+            if (ftruncate(fd, sizeof(CacheHeader) + RESULT_CACHE_CAPACITY * sizeof(CacheEntry)) != 0 ||
+                pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+                flock(fd, LOCK_UN);
                 return false;
             }
+            fstat(fd, &fileStat);
         }
+        flock(fd, LOCK_UN);
 
+        fileSize = fileStat.st_size;
+        void* data = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        header = static_cast<CacheHeader*>(data);
+        entries = reinterpret_cast<CacheEntry*>(header + 1);
+        if (header->magic != RESULT_CACHE_MAGIC || header->configuration != getCacheConfiguration() ||
+            sizeof(CacheHeader) + header->capacity * sizeof(CacheEntry) != fileSize) {
+            munmap(data, fileSize);
+            header = nullptr;
+            return false;
+        }
         return true;
     }
 
-    // Проверка для точки на принадлежность bounding box
-    bool isInTable(const vector<vector<int>>& table, int x, int y) {
-        if (table.empty() || table[0].empty()) {
+    bool isOpen() const {
+        return header != nullptr;
+    }
+
+    // Ответ для набора при данном maximumSize: подходит запись с тем же maximumSize или с большим,
+    // если в ней найден период, влезающий в maximumSize (минимальный период от этого не меняется)
+    bool lookup(const vector<vector<int>>& key, int maximumSize, bool& foundPeriod, int& h, int& w) const {
+        if (!isOpen() || key.size() > MAX_CACHED_TILES) {
             return false;
         }
+        uint64_t hash = getHash(key);
+        for (uint64_t i = hash % header->capacity, step = 0; step < header->capacity; i = (i + 1) % header->capacity, ++step) {
+            const CacheEntry& entry = entries[i];
+            if (!__atomic_load_n(&entry.ready, __ATOMIC_ACQUIRE)) {
+                if (__atomic_load_n(&entry.hash, __ATOMIC_ACQUIRE) == 0) {
+                    return false;
+                }
+                continue; // ячейку сейчас пишут
+            }
+            if (entry.hash != hash || !isSameKey(entry, key)) {
+                continue;
+            }
+            bool usable = entry.maximumSize == maximumSize ||
+                (entry.maximumSize > maximumSize && entry.foundPeriod && entry.h <= maximumSize && entry.w <= maximumSize);
+            if (usable) {
+                foundPeriod = entry.foundPeriod;
+                h = entry.h;
+                w = entry.w;
+                return true;
+            }
+        }
+        return false;
+    }
 
-        return x >= 0 && x < (int)table.size() && y >= 0 && y < (int)table[0].size();
+    void insert(const vector<vector<int>>& key, int maximumSize, bool foundPeriod, int h, int w) {
+        if (!isOpen() || key.size() > MAX_CACHED_TILES) {
+            return;
+        }
+        uint64_t hash = getHash(key);
+        lock_guard<mutex> lock(writeMutex);
+        flock(fd, LOCK_EX);
+        // заполненную до конца таблицу не трогаем, чтобы пробы не зацикливались
+        if (header->numberOfEntries * 10 < header->capacity * 9) {
+            uint64_t i = hash % header->capacity;
+            while (entries[i].hash != 0) {
+                i = (i + 1) % header->capacity;
+            }
+            CacheEntry& entry = entries[i];
+            entry.numberOfTiles = key.size();
+            for (int tile = 0; tile < (int)key.size(); ++tile) {
+                for (int side = 0; side < 4; ++side) {
+                    entry.tiles[tile][side] = key[tile][side];
+                }
+            }
+            entry.maximumSize = maximumSize;
+            entry.foundPeriod = foundPeriod;
+            entry.h = h;
+            entry.w = w;
+            __atomic_store_n(&entry.hash, hash, __ATOMIC_RELEASE);
+            __atomic_store_n(&entry.ready, 1, __ATOMIC_RELEASE);
+            ++header->numberOfEntries;
+        }
+        flock(fd, LOCK_UN);
     }
 
-    // Проверка для тайла можно ли его поставить в данную точку
-    bool canPutTile(const vector<vector<int>>& table, int x, int y, int type) {
-        //cout << "x = " << x << " y = " << y << endl;
-        assert(isInTable(table, x, y));
+private:
+    int fd = -1;
+    size_t fileSize = 0;
+    CacheHeader* header = nullptr;
+    CacheEntry* entries = nullptr;
+    mutex writeMutex;
 
-        for (int dir = 0; dir < 4; ++dir) {
-            int nx = x + dx[dir];
-            int ny = y + dy[dir];
-            if (!isInTable(table, nx, ny)) continue;
-            if (table[nx][ny] == -1) continue;
-            if (!isSame(type, table[nx][ny], dir)) {
-                return false;
+    static uint64_t getHash(const vector<vector<int>>& key) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (const auto& tile : key) {
+            for (int side : tile) {
+                hash = (hash ^ (uint8_t)side) * 1099511628211ULL;
             }
         }
+        hash = (hash ^ key.size()) * 1099511628211ULL;
+        return hash == 0 ? 1 : hash;
+    }
 
+    static bool isSameKey(const CacheEntry& entry, const vector<vector<int>>& key) {
+        if (entry.numberOfTiles != key.size()) {
+            return false;
+        }
+        for (int tile = 0; tile < (int)key.size(); ++tile) {
+            for (int side = 0; side < 4; ++side) {
+                if (entry.tiles[tile][side] != key[tile][side]) {
+                    return false;
+                }
+            }
+        }
         return true;
     }
+};
 
-    // конструкции вида: vector<vector<vector<vector<vector<int>>>>> - это смерть, 3 - тоже плохо, но не совсем смерть
-    // Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
-    const int N = 123;
-    vector<vector<vector<int>>> allTables[N][N];
-    vector<vector<int>> minimumTilingRectangle;
-    vector<vector<int>> maximumTiledRectangle;
-    bool foundPeriod;
+ResultCache resultCache;
 
-    // Обновить ответы замощённым прямоугольником
-    void relaxAnswers(const vector<vector<int>>& table) {
-        if (isTilingRectangle(table)) {
-            minimumTilingRectangle = table;
-            foundPeriod = true;
+// Канонический представитель класса симметрии набора (минимальный образ)
+vector<vector<int>> getCanonicalSet(const vector<vector<int>>& tiles) {
+    vector<int> codes;
+    for (const auto& tile : tiles) {
+        codes.push_back(getTileCode(tile));
+    }
+    sort(codes.begin(), codes.end());
+    vector<int> best = codes, image(codes.size());
+    for (const auto& symmetry : symmetries) {
+        for (int i = 0; i < (int)codes.size(); ++i) {
+            image[i] = symmetry[codes[i]];
         }
-        allTables[table.size()][table[0].size()].push_back(table);
+        sort(image.begin(), image.end());
+        best = min(best, image);
     }
+    vector<vector<int>> canonical;
+    for (int code : best) {
+        canonical.push_back(allTiles[code]);
+    }
+    return canonical;
+}
 
-    // Рекурсивная штука пытается заполнить полоску от таблички (из -1)
-    //  0  1 -1
-    //  1  2 -1
-    // -1 -1 -1
-    void recTryToAdd(vector<vector<int>>& table, int x, int y) {
-        if (x == -1) {
-            relaxAnswers(table);
-        } else {
-            assert(!table.empty());
-            assert(!table[0].empty());
-            int m = table[0].size();
-
-            int nx = x, ny = y;
-            if (ny + 1 < m) {
-                ++ny;
-            } else {
-                --nx;
-            }
+// Выводить ответ для набора из периодов его поднаборов, а Solver запускать, только если вывести нельзя (1 - нет, 2 - да)
+// Если в наборе лежит свидетель - тайлы уже найденного периода h * w, то набор замощает, и его минимальный период
+// не позже h * w в порядке перебора, так что остаётся проверить на торе только более ранние размеры.
+// Наборы без периода так не выводятся: все наборы одного размера, и содержащий набор - это сам набор
+const int INFERENCE_OPTIMIZATION = 1;
 
-            for (int type = 0; type < numberOfTiles; ++type) {
-                if (!canPutTile(table, x, y, type)) continue;
-                
-                table[x][y] = type;
-                recTryToAdd(table, nx, ny);
-                table[x][y] = -1;
-            }
-        }
-    }    
+// Решать вместо набора его живые тайлы (1 - нет, 2 - да)
+// Тайл, у которого с какой-то стороны нет соседа среди живых, в период не входит, так что минимальный период
+// набора и его живой части совпадают, а ключ кэша и перебор становятся меньше. Меняется статистика наборов без периода:
+// максимальный замощённый прямоугольник считается по живой части, а наборы без живых тайлов не решаются и идут в ячейку 0 * 0
+const int REDUCTION_OPTIMIZATION = 1;
 
-    // Расширяет прямоугольник в нужную сторону и запускает рекурсию
-    void tryToAdd(const vector<vector<int>>& baseTable, int n, int m) {
-        auto table = baseTable;
-        for (int x = 0; x < n; ++x) {
-            if (table.size() == x) {
-                table.push_back(vector<int>(m, -1));
+// Живые тайлы набора: тайлы без соседа с какой-то стороны убираются, пока такие есть.
+// originalIndex[i] - номер i-го живого тайла в исходном наборе
+vector<vector<int>> reduceTiles(const vector<vector<int>>& tiles, vector<int>& originalIndex) {
+    vector<char> alive(tiles.size(), 1);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int type = 0; type < (int)tiles.size(); ++type) {
+            if (!alive[type]) {
+                continue;
             }
-            while (table[x].size() < m) {
-                table[x].push_back(-1);
+            for (int dir = 0; dir < numberOfSides && alive[type]; ++dir) {
+                bool hasNeighbour = false;
+                for (int other = 0; other < (int)tiles.size() && !hasNeighbour; ++other) {
+                    hasNeighbour = alive[other] && tiles[type][dir] == tiles[other][dir ^ 2];
+                }
+                if (!hasNeighbour) {
+                    alive[type] = 0;
+                    changed = true;
+                }
             }
         }
-
-        recTryToAdd(table, n - 1, 0);
     }
+    vector<vector<int>> reduced;
+    originalIndex.clear();
+    for (int type = 0; type < (int)tiles.size(); ++type) {
+        if (alive[type]) {
+            reduced.push_back(tiles[type]);
+            originalIndex.push_back(type);
+        }
+    }
+    return reduced;
+}
 
-    // Перебирать или не перебирать периоды x * 1 (1 - да, 2 - нет)
-    const int FIRST_SQUARE_OPTIMIZATION = 1;
+// Отбрасывать до Solver-а наборы, которые не проходят дешёвые необходимые условия периода (1 - нет, 2 - да)
+// Такие наборы не замощают ни один тор, но прямоугольник для них не ищется: они, как и наборы без живых тайлов,
+// идут в ячейку 0 * 0 статистики наборов без периода
+const int FILTER_OPTIMIZATION = 1;
 
-    // Перебирать или не перебирать периоды n * m, n < m (1 - да, 2 - нет)
-    const int LEXICOGRAPHIC_OPTIMIZATION = 1;
+const char* FILTER_NAMES[NUMBER_OF_FILTERS] = {"horizontal cycle", "vertical cycle", "cycle support"};
 
-    // main
-    void run() {
-        for (int h = 0; h <= maximumSize; ++h) {
-            for (int w = 0; w <= maximumSize; ++w) {
-                allTables[h][w].clear();
-                if (h == 0 || w == 0) {
-                    allTables[h][w].push_back(vector<vector<int>>());
-                }
+// Граф цветов: тайл - ребро из цвета стороны from в цвет стороны to.
+// reach[a][b] - есть ли непустой путь из a в b по рёбрам живых тайлов
+vector<vector<char>> getColorReach(const vector<vector<int>>& tiles, const vector<char>& alive, int from, int to) {
+    vector<vector<char>> reach(numberOfColors, vector<char>(numberOfColors, 0));
+    for (int type = 0; type < (int)tiles.size(); ++type) {
+        if (alive[type]) {
+            reach[tiles[type][from]][tiles[type][to]] = 1;
+        }
+    }
+    for (int middle = 0; middle < numberOfColors; ++middle) {
+        for (int a = 0; a < numberOfColors; ++a) {
+            if (!reach[a][middle]) {
+                continue;
             }
-        } 
-
-        foundPeriod = false;
-
-        for (int h = 1; h <= maximumSize && !foundPeriod; ++h) {
-            for (int w = min(h, FIRST_SQUARE_OPTIMIZATION); w <= (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h) && !foundPeriod; ++w) {
-                for (const auto& baseTable : allTables[h - 1][w - 1]) {
-                    if (foundPeriod) {
-                        break;
-                    } else {
-                        tryToAdd(baseTable, h, w);
-                    }
-                }
+            for (int b = 0; b < numberOfColors; ++b) {
+                reach[a][b] |= reach[middle][b];
             }
         }
+    }
+    return reach;
+}
 
-        for (int h = 1; h <= maximumSize; ++h) {
-            for (int w = 1; w <= h; ++w) {
-                for (const auto& table : allTables[h][w]) {
-                    if (!isTilingRectangle(table)) {
-                        maximumTiledRectangle = table;
-                    }
-                }
-            }
+bool hasColorCycle(const vector<vector<int>>& tiles, int from, int to) {
+    auto reach = getColorReach(tiles, vector<char>(tiles.size(), 1), from, to);
+    for (int color = 0; color < numberOfColors; ++color) {
+        if (reach[color][color]) {
+            return true;
         }
     }
+    return false;
+}
 
-    // Эта часть для внешнего доступа, запускает Solver на заданном наборе тайлов и выдаёт требуемые ответы
-    void solve(
-        const int _numberOfTiles,
-        const int _maximumSize,
-        const vector<vector<int>>& _tiles,
-        bool& _foundPeriod,
-        vector<vector<int>>& _minimumTilingRectangle,
-        vector<vector<int>>& _maximumTiledRectangle
-        ) {
-        numberOfTiles = _numberOfTiles;
-        maximumSize = _maximumSize;
-        tiles = _tiles;
-        run();
-        _foundPeriod = foundPeriod;
-        _minimumTilingRectangle = minimumTilingRectangle;
-        _maximumTiledRectangle = maximumTiledRectangle;
+// Строка тора - цикл в графе цветов слева направо, столбец - цикл сверху вниз, поэтому в торе
+// ребро каждого тайла лежит на цикле в обоих графах. Тайлы, у которых это не так, убираются, пока такие есть
+bool hasCycleSupport(const vector<vector<int>>& tiles) {
+    vector<char> alive(tiles.size(), 1);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        auto horizontal = getColorReach(tiles, alive, 3, 1);
+        auto vertical = getColorReach(tiles, alive, 0, 2);
+        for (int type = 0; type < (int)tiles.size(); ++type) {
+            const auto& tile = tiles[type];
+            if (alive[type] && (!horizontal[tile[1]][tile[3]] || !vertical[tile[2]][tile[0]])) {
+                alive[type] = 0;
+                changed = true;
+            }
+        }
     }
-};
-
-int numberOfTiles;
-int numberOfColors;
-int maximumSize;
-
-// Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
-const int N = 123;    
-
-void inputParameters() {
-    cout << "input number of tiles, number of colors (on both sides), maximum size for check" << endl;
-    cin >> numberOfTiles >> numberOfColors >> maximumSize;
-    assert(maximumSize < N);
+    return count(alive.begin(), alive.end(), 1) > 0;
 }
 
-int numberOfAllSets;
-
-int numberOfAllTilingSets;
-int numberOfAllNonTilingSets;
-
-int numberOfTilingSets[N][N];
-int numberOfNonTilingSets[N][N];
-
-vector<vector<int>> sampleTilingSet[N][N];
-vector<vector<int>> sampleTilingRectangle[N][N];
+// Номер первого фильтра, который отбросил набор, или -1
+int getRejectingFilter(const vector<vector<int>>& tiles) {
+    if (!hasColorCycle(tiles, 3, 1)) {
+        return 0;
+    }
+    if (!hasColorCycle(tiles, 0, 2)) {
+        return 1;
+    }
+    if (!hasCycleSupport(tiles)) {
+        return 2;
+    }
+    return -1;
+}
 
-vector<vector<int>> sampleNonTilingSet[N][N];
-vector<vector<int>> sampleNonTilingRectangle[N][N];
+vector<int> getWitnessCodes(const vector<vector<int>>& tiles, const vector<vector<int>>& rectangle) {
+    vector<int> codes;
+    for (const auto& row : rectangle) {
+        for (int cell : row) {
+            codes.push_back(getTileCode(tiles[cell]));
+        }
+    }
+    sort(codes.begin(), codes.end());
+    codes.erase(unique(codes.begin(), codes.end()), codes.end());
+    return codes;
+}
 
-// Инициализирует все массивы и счётчики
-void initData() {
-    numberOfAllSets = 0;
+const int OUTPUT_EVERY_CONST_ITERATIONS = 10000;
 
-    numberOfAllTilingSets = 0;
-    numberOfAllNonTilingSets = 0;
+mutex outputMutex;
 
-    for (int h = 0; h < N; ++h) {
-        for (int w = 0; w < N; ++w) {
-            numberOfTilingSets[h][w] = 0;
-            numberOfNonTilingSets[h][w] = 0;
+// Обновить ответы заданным набором тайлов, order - его ранг (примером становится набор с меньшим рангом),
+// weight - сколько наборов он представляет (размер класса симметрии)
+void relaxAnswers(const vector<vector<int>>& tiles, Worker& worker, long long order, long long weight) {
+    Statistics& statistics = worker.statistics;
+    bool foundPeriod = false;
+    int h = 0, w = 0;
+    vector<vector<int>> minimumTilingRectangle;
+    vector<vector<int>> maximumTiledRectangle;
 
-            sampleTilingSet[h][w] = {};
-            sampleTilingRectangle[h][w] = {};
+    // решается живая часть набора, номера тайлов в прямоугольниках переводятся обратно в конце
+    vector<vector<int>> solvedTiles = tiles;
+    vector<int> originalIndex;
+    if (REDUCTION_OPTIMIZATION == 2) {
+        solvedTiles = reduceTiles(tiles, originalIndex);
+    }
+    // без поиска решаются наборы без живых тайлов и наборы, отброшенные фильтрами
+    bool decidedWithoutSearch = solvedTiles.empty();
+    if (FILTER_OPTIMIZATION == 2 && !decidedWithoutSearch) {
+        int filter = getRejectingFilter(solvedTiles);
+        if (filter != -1) {
+            numberOfFilteredSets[filter] += weight;
+            decidedWithoutSearch = true;
+        }
+    }
 
-            sampleNonTilingSet[h][w] = {};
-            sampleNonTilingRectangle[h][w] = {};
+    vector<vector<int>> cacheKey;
+    bool cached = false;
+    if (RESULT_CACHE_OPTIMIZATION == 2 && !decidedWithoutSearch) {
+        cacheKey = getCanonicalSet(solvedTiles);
+        cached = resultCache.lookup(cacheKey, maximumSize, foundPeriod, h, w);
+        // прямоугольника в кэше нет, так что если набор станет примером - всё равно решаем
+        if (cached && foundPeriod && (statistics.numberOfTilingSets[h][w] == 0 || order < statistics.sampleTilingOrder[h][w])) {
+            cached = false;
+        }
+        if (cached && !foundPeriod && (statistics.numberOfNonTilingSets[h][w] == 0 || order < statistics.sampleNonTilingOrder[h][w])) {
+            cached = false;
         }
     }
-}
 
-const int numberOfSides = 4;
-vector<vector<int>> allTiles;
+    bool inferred = false;
+    int inferredH = 0, inferredW = 0;
+    if (!cached && !decidedWithoutSearch && INFERENCE_OPTIMIZATION == 2) {
+        vector<int> codes;
+        for (const auto& tile : solvedTiles) {
+            codes.push_back(getTileCode(tile));
+        }
+        sort(codes.begin(), codes.end());
+        if (worker.witnesses.findSubset(codes, inferredH, inferredW)) {
+            if (worker.solver.findEarlierPeriod(solvedTiles.size(), maximumSize, solvedTiles, inferredH, inferredW, minimumTilingRectangle)) {
+                worker.witnesses.insert(getWitnessCodes(solvedTiles, minimumTilingRectangle), inferredH, inferredW);
+            }
+            if (worker.solver.isOutOfBudget()) {
+                worker.undecided.push_back({tiles, order, weight});
+                return;
+            }
+            // в пример идёт прямоугольник Solver-а, так что если набор станет примером - всё равно решаем
+            inferred = statistics.numberOfTilingSets[inferredH][inferredW] != 0 && order >= statistics.sampleTilingOrder[inferredH][inferredW];
+            if (inferred) {
+                foundPeriod = true;
+                h = inferredH, w = inferredW;
+            }
+        }
+    }
 
-// Генерация всех тайлов с заданными цветами
-void genAllTiles(vector<int> tile) {
-    if (tile.size() == numberOfSides) {
-        allTiles.push_back(tile);
+    if (decidedWithoutSearch) {
+        // периода нет, прямоугольник не ищется - ячейка 0 * 0
+    } else if (cached) {
+        ++numberOfCachedSets;
+    } else if (inferred) {
+        ++numberOfInferredSets;
+        if (RESULT_CACHE_OPTIMIZATION == 2) {
+            resultCache.insert(cacheKey, maximumSize, foundPeriod, h, w);
+        }
     } else {
-        tile.push_back(0);
-        for (int i = 0; i < numberOfColors; ++i) {
-            tile[tile.size() - 1] = i;
-            genAllTiles(tile);
-        } 
+        worker.solver.solve(solvedTiles.size(), maximumSize, solvedTiles, foundPeriod, minimumTilingRectangle, maximumTiledRectangle);
+        ++numberOfSolvedSets;
+        if (worker.solver.isOutOfBudget()) {
+            worker.undecided.push_back({tiles, order, weight});
+            return;
+        }
+        const auto& rectangle = foundPeriod ? minimumTilingRectangle : maximumTiledRectangle;
+        assert(!rectangle.empty());
+        h = rectangle.size();
+        assert(!rectangle[0].empty());
+        w = rectangle[0].size();
+        assert(inferredH == 0 || (foundPeriod && h == inferredH && w == inferredW));
+        if (INFERENCE_OPTIMIZATION == 2 && foundPeriod) {
+            worker.witnesses.insert(getWitnessCodes(solvedTiles, minimumTilingRectangle), h, w);
+        }
+        if (RESULT_CACHE_OPTIMIZATION == 2) {
+            resultCache.insert(cacheKey, maximumSize, foundPeriod, h, w);
+        }
     }
-}
 
-const int OUTPUT_EVERY_CONST_ITERATIONS = 10000;
+    if (REDUCTION_OPTIMIZATION == 2) {
+        for (auto* rectangle : {&minimumTilingRectangle, &maximumTiledRectangle}) {
+            for (auto& row : *rectangle) {
+                for (auto& cell : row) {
+                    cell = originalIndex[cell];
+                }
+            }
+        }
+    }
 
-// Обновить ответы заданным набором тайлов
-void relaxAnswers(const vector<vector<int>>& tiles) {
-    bool foundPeriod = false;
-    vector<vector<int>> minimumTilingRectangle;
-    vector<vector<int>> maximumTiledRectangle;
-    Solver::solve(numberOfTiles, maximumSize, tiles, foundPeriod, minimumTilingRectangle, maximumTiledRectangle);
     if (foundPeriod) {
-        ++numberOfAllTilingSets;
-        assert(!minimumTilingRectangle.empty());
-        int h = minimumTilingRectangle.size();
-        assert(!minimumTilingRectangle[0].empty());
-        int w = minimumTilingRectangle[0].size();
-        ++numberOfTilingSets[h][w];
-        if (numberOfTilingSets[h][w] == 1) {
-            sampleTilingSet[h][w] = tiles;
-            sampleTilingRectangle[h][w] = minimumTilingRectangle;
+        numberOfAllTilingSets += weight;
+        if (statistics.numberOfTilingSets[h][w] == 0 || order < statistics.sampleTilingOrder[h][w]) {
+            statistics.sampleTilingSet[h][w] = tiles;
+            statistics.sampleTilingRectangle[h][w] = minimumTilingRectangle;
+            statistics.sampleTilingOrder[h][w] = order;
         }
+        statistics.numberOfTilingSets[h][w] += weight;
     } else {
-        ++numberOfAllNonTilingSets;
-        assert(!maximumTiledRectangle.empty());
-        int h = maximumTiledRectangle.size();
-        assert(!maximumTiledRectangle[0].empty());
-        int w = maximumTiledRectangle[0].size();
-        ++numberOfNonTilingSets[h][w];
-        if (numberOfNonTilingSets[h][w] == 1) {
-            sampleNonTilingSet[h][w] = tiles;
-            sampleNonTilingRectangle[h][w] = maximumTiledRectangle;
-        }
-    }
-    ++numberOfAllSets;
-    if (numberOfAllSets % OUTPUT_EVERY_CONST_ITERATIONS == 0) {
-        cout << "Checked first " << numberOfAllSets << " sets" << endl;
+        numberOfAllNonTilingSets += weight;
+        if (statistics.numberOfNonTilingSets[h][w] == 0 || order < statistics.sampleNonTilingOrder[h][w]) {
+            statistics.sampleNonTilingSet[h][w] = tiles;
+            statistics.sampleNonTilingRectangle[h][w] = maximumTiledRectangle;
+            statistics.sampleNonTilingOrder[h][w] = order;
+        }
+        statistics.numberOfNonTilingSets[h][w] += weight;
+    }
+    long long checkedSets = numberOfAllSets += weight;
+    if (checkedSets / OUTPUT_EVERY_CONST_ITERATIONS != (checkedSets - weight) / OUTPUT_EVERY_CONST_ITERATIONS) {
+        lock_guard<mutex> lock(outputMutex);
+        cout << "Checked first " << checkedSets << " sets" << endl;
         cout << "Number of tiling sets = " << numberOfAllTilingSets << endl;
         cout << "Number of non tiling sets = " << numberOfAllNonTilingSets << endl;
         cout << endl;
     }
 }
 
-// Первый тайл в наборе (0 0 <=1 <=1) (1 - нет, 2 - да)
-const int FIRST_OPTIMUM_TILE_OPTIMIZATION = 2; 
+// Ранг набора - его номер в порядке обхода recAllSetOfTiles (с учётом отсечённых наборов)
+// Поддерево с позицией pos и sizeOfSet взятыми тайлами содержит C(allTiles.size() - pos, numberOfTiles - sizeOfSet) наборов
+const long long MAX_RANK = numeric_limits<long long>::max() / 2;
+vector<vector<long long>> binomial;
+
+void genBinomial() {
+    binomial.assign(allTiles.size() + 1, vector<long long>(numberOfTiles + 1, 0));
+    for (int n = 0; n <= (int)allTiles.size(); ++n) {
+        binomial[n][0] = 1;
+        for (int k = 1; k <= min(n, numberOfTiles); ++k) {
+            binomial[n][k] = min(MAX_RANK, binomial[n - 1][k - 1] + binomial[n - 1][k]);
+        }
+    }
+}
+
+long long countSets(int pos, int sizeOfSet) {
+    return binomial[allTiles.size() - pos][numberOfTiles - sizeOfSet];
+}
 
-// Перебор всех наборов тайлов
-void recAllSetOfTiles(vector<vector<int>>& tiles, int sizeOfSet, int pos) {
+// Перебор наборов с рангами из [begin, end), rank - ранг первого набора поддерева
+void recAllSetOfTiles(vector<vector<int>>& tiles, int sizeOfSet, int pos, Worker& worker, long long rank, long long begin, long long end) {
+    if (rank >= end || rank + countSets(pos, sizeOfSet) <= begin) {
+        return;
+    }
     if (sizeOfSet == numberOfTiles) {
-        relaxAnswers(tiles);    
+        long long weight = SYMMETRY_OPTIMIZATION == 2 ? getSymmetryWeight(tiles) : 1;
+        if (weight != 0) {
+            relaxAnswers(tiles, worker, rank, weight);
+        }
     } else if (pos < allTiles.size()) {
-        recAllSetOfTiles(tiles, sizeOfSet, pos + 1);
+        recAllSetOfTiles(tiles, sizeOfSet, pos + 1, worker, rank, begin, end);
         if (FIRST_OPTIMUM_TILE_OPTIMIZATION == 2) {
             if (sizeOfSet == 0) {
                 if (allTiles[pos][0] != 0 || allTiles[pos][1] != 0 || allTiles[pos][2] > 1 || allTiles[pos][3] > 1) {
@@ -314,8 +1897,213 @@ void recAllSetOfTiles(vector<vector<int>>& tiles, int sizeOfSet, int pos) {
             }
         }
         tiles[sizeOfSet] = allTiles[pos];
-        recAllSetOfTiles(tiles, sizeOfSet + 1, pos + 1);
+        recAllSetOfTiles(tiles, sizeOfSet + 1, pos + 1, worker, rank + countSets(pos + 1, sizeOfSet), begin, end);
+    }
+}
+
+// Параллельный перебор на всех ядрах (1 - нет, 2 - да)
+const int PARALLEL_OPTIMIZATION = 2;
+
+// На сколько отрезков рангов на каждый поток режется кусок перебора
+const int TASKS_PER_WORKER = 64;
+
+// Очередь задач одного потока, свободный поток ворует задачи с конца чужих очередей
+struct WorkQueue {
+    mutex queueMutex;
+    deque<int> tasks;
+};
+
+bool takeTask(vector<WorkQueue>& queues, int worker, int& task) {
+    {
+        lock_guard<mutex> lock(queues[worker].queueMutex);
+        if (!queues[worker].tasks.empty()) {
+            task = queues[worker].tasks.front();
+            queues[worker].tasks.pop_front();
+            return true;
+        }
+    }
+    for (int shift = 1; shift < (int)queues.size(); ++shift) {
+        auto& victim = queues[(worker + shift) % queues.size()];
+        lock_guard<mutex> lock(victim.queueMutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Параллельный перебор рангов [begin, end): отрезок режется на задачи, у каждого потока свой Worker
+void parallelAllSetOfTiles(long long begin, long long end) {
+    int numberOfWorkers = max(1u, thread::hardware_concurrency());
+    int numberOfTasks = min<long long>(end - begin, (long long)TASKS_PER_WORKER * numberOfWorkers);
+    long long taskSize = (end - begin + numberOfTasks - 1) / numberOfTasks;
+    vector<WorkQueue> queues(numberOfWorkers);
+    for (int i = 0; i < numberOfTasks; ++i) {
+        queues[i % numberOfWorkers].tasks.push_back(i);
+    }
+
+    vector<unique_ptr<Worker>> workers(numberOfWorkers);
+    vector<thread> threads;
+    for (int worker = 0; worker < numberOfWorkers; ++worker) {
+        workers[worker] = make_unique<Worker>();
+        threads.emplace_back([&, worker]() {
+            vector<vector<int>> tiles(numberOfTiles);
+            int task;
+            while (takeTask(queues, worker, task)) {
+                long long taskBegin = begin + taskSize * task;
+                recAllSetOfTiles(tiles, 0, 0, *workers[worker], 0, taskBegin, min(end, taskBegin + taskSize));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& worker : workers) {
+        worker->mergeInto(results);
+    }
+}
+
+// Перепроверка отложенных наборов: каждый раунд бюджет растёт в BUDGET_GROWTH раз, наборы делятся между всеми ядрами
+// Не решившиеся и в последнем раунде засчитываются как нерешённые
+void retryUndecidedSets() {
+    long long nodeBudget = NODE_BUDGET, memoryBudget = MEMORY_BUDGET;
+    for (int round = 1; round <= RETRY_ROUNDS && !undecidedSets.empty(); ++round) {
+        nodeBudget *= BUDGET_GROWTH;
+        memoryBudget *= BUDGET_GROWTH;
+        cout << "retry round " << round << ": " << undecidedSets.size() << " undecided sets, node budget = " << nodeBudget << endl;
+        vector<UndecidedSet> sets;
+        sets.swap(undecidedSets);
+        int numberOfWorkers = PARALLEL_OPTIMIZATION == 2 ? max(1u, thread::hardware_concurrency()) : 1;
+        atomic<size_t> nextSet(0);
+        vector<unique_ptr<Worker>> workers(numberOfWorkers);
+        vector<thread> threads;
+        for (int worker = 0; worker < numberOfWorkers; ++worker) {
+            workers[worker] = make_unique<Worker>(nodeBudget, memoryBudget);
+            threads.emplace_back([&, worker]() {
+                for (size_t i = nextSet++; i < sets.size(); i = nextSet++) {
+                    relaxAnswers(sets[i].tiles, *workers[worker], sets[i].order, sets[i].weight);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& worker : workers) {
+            worker->mergeInto(results);
+        }
+    }
+    for (const auto& set : undecidedSets) {
+        numberOfUndecidedSets += set.weight;
+        numberOfAllSets += set.weight;
+    }
+    cout << "retryUndecidedSets: ok" << endl;
+    cout << endl;
+}
+
+// Перебираемые ранги [rangeBegin, rangeEnd), rangeEnd == -1 - до конца
+long long rangeBegin = 0;
+long long rangeEnd = -1;
+int shardIndex = 0;
+int numberOfShards = 1;
+
+// Контрольные точки: перебор идёт кусками по CHECKPOINT_RANKS рангов, после каждого куска в файл
+// пишутся параметры, отрезок рангов, докуда он пройден, счётчики и статистика
+const long long CHECKPOINT_RANKS = 1 << 24;
+const string CHECKPOINT_HEADER = "wang-tile-checkpoint-4";
+string checkpointFile; // пусто - без контрольных точек
+long long nextRank; // ранги [rangeBegin, nextRank) уже перебраны
+
+// Файлы контрольных точек шардов, которые нужно склеить вместо перебора
+vector<string> mergeFiles;
+
+void saveCheckpoint() {
+    string temporaryFile = checkpointFile + ".tmp";
+    ofstream out(temporaryFile);
+    out << CHECKPOINT_HEADER << "\n";
+    out << numberOfTiles << " " << numberOfColors << " " << maximumSize << "\n";
+    out << rangeBegin << " " << rangeEnd << " " << nextRank << "\n";
+    out << numberOfAllSets << " " << numberOfSolvedSets << " " << numberOfCachedSets << " " << numberOfInferredSets << " ";
+    out << numberOfAllTilingSets << " " << numberOfAllNonTilingSets << "\n";
+    for (const auto& filtered : numberOfFilteredSets) {
+        out << filtered << " ";
+    }
+    out << "\n";
+    results.save(out);
+    // отложенные наборы: ранг, вес и коды тайлов
+    out << undecidedSets.size() << "\n";
+    for (const auto& set : undecidedSets) {
+        out << set.order << " " << set.weight;
+        for (const auto& tile : set.tiles) {
+            out << " " << getTileCode(tile);
+        }
+        out << "\n";
+    }
+    out.close();
+    // rename атомарен, так что при падении во время записи остаётся предыдущая точка
+    if (!out || rename(temporaryFile.c_str(), checkpointFile.c_str()) != 0) {
+        lock_guard<mutex> lock(outputMutex);
+        cout << "can't write checkpoint " << checkpointFile << endl;
+    }
+}
+
+// Прочитать контрольную точку и добавить её счётчики и статистику к текущим
+// Параметры перебора в файле должны совпадать с текущими
+bool loadCheckpoint(const string& fileName, long long& begin, long long& end, long long& next) {
+    ifstream in(fileName);
+    string header;
+    int tiles, colors, size;
+    long long sets, solvedSets, cachedSets, inferredSets, tilingSets, nonTilingSets;
+    if (!(in >> header >> tiles >> colors >> size >> begin >> end >> next) || header != CHECKPOINT_HEADER) {
+        return false;
+    }
+    if (tiles != numberOfTiles || colors != numberOfColors || size != maximumSize) {
+        return false;
+    }
+    if (!(in >> sets >> solvedSets >> cachedSets >> inferredSets >> tilingSets >> nonTilingSets)) {
+        return false;
+    }
+    long long filteredSets[NUMBER_OF_FILTERS];
+    for (auto& filtered : filteredSets) {
+        if (!(in >> filtered)) {
+            return false;
+        }
+    }
+    auto statistics = make_unique<Statistics>();
+    if (!statistics->load(in)) {
+        return false;
+    }
+    size_t numberOfUndecided;
+    if (!(in >> numberOfUndecided)) {
+        return false;
+    }
+    vector<UndecidedSet> undecided(numberOfUndecided);
+    for (auto& set : undecided) {
+        if (!(in >> set.order >> set.weight)) {
+            return false;
+        }
+        set.tiles.resize(numberOfTiles);
+        for (auto& tile : set.tiles) {
+            int code;
+            if (!(in >> code) || code < 0 || code >= (int)allTiles.size()) {
+                return false;
+            }
+            tile = allTiles[code];
+        }
+    }
+    undecidedSets.insert(undecidedSets.end(), undecided.begin(), undecided.end());
+    numberOfAllSets += sets;
+    numberOfSolvedSets += solvedSets;
+    numberOfCachedSets += cachedSets;
+    numberOfInferredSets += inferredSets;
+    for (int filter = 0; filter < NUMBER_OF_FILTERS; ++filter) {
+        numberOfFilteredSets[filter] += filteredSets[filter];
     }
+    numberOfAllTilingSets += tilingSets;
+    numberOfAllNonTilingSets += nonTilingSets;
+    results.merge(*statistics);
+    return true;
 }
 
 // main перебор
@@ -323,26 +2111,113 @@ void generate() {
     genAllTiles({});
     cout << "genAllTiles: ok, numer of tiles = " << allTiles.size() << endl;
     cout << endl;
-    vector<vector<int>> tiles(numberOfTiles);
-    recAllSetOfTiles(tiles, 0, 0);
+    genBinomial();
+    long long numberOfSets = countSets(0, 0);
+    assert(numberOfSets < MAX_RANK);
+    if (numberOfShards > 1) {
+        rangeBegin = (__int128)numberOfSets * shardIndex / numberOfShards;
+        rangeEnd = (__int128)numberOfSets * (shardIndex + 1) / numberOfShards;
+    } else {
+        rangeBegin = min(rangeBegin, numberOfSets);
+        rangeEnd = rangeEnd == -1 ? numberOfSets : min(rangeEnd, numberOfSets);
+    }
+    nextRank = rangeBegin;
+    if (!checkpointFile.empty() && ifstream(checkpointFile)) {
+        long long begin, end;
+        if (!loadCheckpoint(checkpointFile, begin, end, nextRank) || begin != rangeBegin || end != rangeEnd) {
+            cout << "checkpoint " << checkpointFile << " doesn't match this run" << endl;
+            exit(1);
+        }
+        cout << "resume from checkpoint " << checkpointFile << ", rank = " << nextRank << endl;
+        cout << endl;
+    }
+    if (rangeBegin != 0 || rangeEnd != numberOfSets) {
+        cout << "ranks of sets: [" << rangeBegin << ", " << rangeEnd << ") of " << numberOfSets << endl;
+        cout << endl;
+    }
+    if (SYMMETRY_OPTIMIZATION == 2 || RESULT_CACHE_OPTIMIZATION == 2) {
+        genSymmetries();
+    }
+    if (RESULT_CACHE_OPTIMIZATION == 2 && !resultCache.open(RESULT_CACHE_FILE)) {
+        cout << "can't open result cache " << RESULT_CACHE_FILE << ", continue without it" << endl;
+        cout << endl;
+    }
+    while (nextRank < rangeEnd) {
+        long long chunkEnd = rangeEnd - nextRank > CHECKPOINT_RANKS ? nextRank + CHECKPOINT_RANKS : rangeEnd;
+        if (PARALLEL_OPTIMIZATION == 2) {
+            parallelAllSetOfTiles(nextRank, chunkEnd);
+        } else {
+            vector<vector<int>> tiles(numberOfTiles);
+            auto worker = make_unique<Worker>();
+            recAllSetOfTiles(tiles, 0, 0, *worker, 0, nextRank, chunkEnd);
+            worker->mergeInto(results);
+        }
+        nextRank = chunkEnd;
+        if (!checkpointFile.empty()) {
+            saveCheckpoint();
+        }
+    }
     cout << "recAllSetOfTiles: ok" << endl;
     cout << endl;
 }
 
+// Склейка контрольных точек шардов в один отчёт вместо перебора
+void mergeCheckpoints() {
+    genAllTiles({});
+    genBinomial();
+    long long numberOfSets = countSets(0, 0);
+    vector<pair<long long, long long>> checkedRanks;
+    for (const auto& fileName : mergeFiles) {
+        long long begin, end, next;
+        if (!loadCheckpoint(fileName, begin, end, next)) {
+            cout << "can't read checkpoint " << fileName << " for these parameters" << endl;
+            exit(1);
+        }
+        checkedRanks.push_back({begin, next});
+    }
+    sort(checkedRanks.begin(), checkedRanks.end());
+    long long covered = 0;
+    for (const auto& [begin, end] : checkedRanks) {
+        if (begin > covered) {
+            cout << "warning: ranks [" << covered << ", " << begin << ") are not checked" << endl;
+        } else if (begin < covered) {
+            cout << "warning: ranks [" << begin << ", " << min(covered, end) << ") are checked twice" << endl;
+        }
+        covered = max(covered, end);
+    }
+    if (covered < numberOfSets) {
+        cout << "warning: ranks [" << covered << ", " << numberOfSets << ") are not checked" << endl;
+    }
+    cout << "merge: ok" << endl;
+    cout << endl;
+}
+
 // Вывод статистики
 void outputResults() {
     cout << "number of checked sets = " << numberOfAllSets << endl;
+    if (SYMMETRY_OPTIMIZATION == 2) {
+        cout << "number of solved sets (one per symmetry class) = " << numberOfSolvedSets << endl;
+    }
+    if (RESULT_CACHE_OPTIMIZATION == 2) {
+        cout << "number of sets taken from cache = " << numberOfCachedSets << endl;
+    }
+    if (INFERENCE_OPTIMIZATION == 2) {
+        cout << "number of sets inferred from subsets = " << numberOfInferredSets << endl;
+    }
     cout << "number of tiling sets = " << numberOfAllTilingSets << endl;
     cout << "number of non tiling sets = " << numberOfAllNonTilingSets << endl;
+    if (BUDGET_OPTIMIZATION == 2) {
+        cout << "number of undecided sets = " << numberOfUndecidedSets << endl;
+    }
     cout << endl;
 
     cout << "statistics on the number of tiling sets for a given minimum period" << endl;
     for (int h = 1; h < N; ++h) {
         for (int w = 1; w < N; ++w) {
-            if (numberOfTilingSets[h][w] == 0) {
+            if (results.numberOfTilingSets[h][w] == 0) {
                 continue;
             } else {
-                cout << "h = " << h << " w = " << w << " number of tiling sets = " << numberOfTilingSets[h][w] << endl;
+                cout << "h = " << h << " w = " << w << " number of tiling sets = " << results.numberOfTilingSets[h][w] << endl;
             }
         }
     }
@@ -351,13 +2226,21 @@ void outputResults() {
     cout << "statistics on the number of non tiling sets for a given maximum tiled rectangle" << endl;
     for (int h = 1; h < N; ++h) {
         for (int w = 1; w < N; ++w) {
-            if (numberOfNonTilingSets[h][w] == 0) {
+            if (results.numberOfNonTilingSets[h][w] == 0) {
                 continue;
             } else {
-                cout << "h = " << h << " w = " << w << " number of non tiling sets = " << numberOfNonTilingSets[h][w] << endl;
+                cout << "h = " << h << " w = " << w << " number of non tiling sets = " << results.numberOfNonTilingSets[h][w] << endl;
             }
         }
     }
+    if (REDUCTION_OPTIMIZATION == 2 || FILTER_OPTIMIZATION == 2) {
+        cout << "number of non tiling sets decided without search = " << results.numberOfNonTilingSets[0][0] << endl;
+    }
+    if (FILTER_OPTIMIZATION == 2) {
+        for (int filter = 0; filter < NUMBER_OF_FILTERS; ++filter) {
+            cout << "number of sets rejected by filter " << FILTER_NAMES[filter] << " = " << numberOfFilteredSets[filter] << endl;
+        }
+    }
     cout << endl;
 }
 
@@ -374,11 +2257,11 @@ void answerForQueries() {
             cout << "input size of minimum tiling rectangle: (height width)" << endl;
             int h, w;
             cin >> h >> w;
-            if (numberOfTilingSets[h][w] == 0) {
+            if (results.numberOfTilingSets[h][w] == 0) {
                 cout << "fail: there aren't relevant sets for your's query" << endl;
             } else {
                 cout << "sample set" << endl;
-                for (const auto& tile : sampleTilingSet[h][w]) {
+                for (const auto& tile : results.sampleTilingSet[h][w]) {
                     for (const auto& side : tile) {
                         cout << side << " ";
                     }
@@ -387,7 +2270,7 @@ void answerForQueries() {
                 cout << "minimum period for sample set" << endl;
                 for (int x = 0; x < h; ++x) {
                     for (int y = 0; y < w; ++y) {
-                        cout << static_cast<char>('A' + sampleTilingRectangle[h][w][x][y]);
+                        cout << static_cast<char>('A' + results.sampleTilingRectangle[h][w][x][y]);
                     }
                     cout << endl;
                 }
@@ -396,11 +2279,11 @@ void answerForQueries() {
             cout << "input size of maximum tiled rectangle: (height width)" << endl;
             int h, w;
             cin >> h >> w;
-            if (numberOfNonTilingSets[h][w] == 0) {
+            if (results.numberOfNonTilingSets[h][w] == 0) {
                 cout << "fail: there aren't relevant sets for your's query" << endl;
             } else {
                 cout << "sample set" << endl;
-                for (const auto& tile : sampleNonTilingSet[h][w]) {
+                for (const auto& tile : results.sampleNonTilingSet[h][w]) {
                     for (const auto& side : tile) {
                         cout << side << " ";
                     }
@@ -409,7 +2292,7 @@ void answerForQueries() {
                 cout << "maximum tiled rectangle for sample set" << endl;
                 for (int x = 0; x < h; ++x) {
                     for (int y = 0; y < w; ++y) {
-                        cout << static_cast<char>('A' + sampleNonTilingRectangle[h][w][x][y]);
+                        cout << static_cast<char>('A' + results.sampleNonTilingRectangle[h][w][x][y]);
                     }
                     cout << endl;
                 }
@@ -419,10 +2302,49 @@ void answerForQueries() {
     }
 }
 
-int main() {
+// Аргументы командной строки (все необязательные):
+//   range <begin> <end> - перебрать только наборы с рангами из [begin, end)
+//   shard <i> <k> - перебрать i-ю из k равных частей рангов (0 <= i < k)
+//   checkpoint <file> - сохранять прогресс в файл и продолжить с него после перезапуска
+//   merge <file>... - не перебирать, а склеить контрольные точки шардов в один отчёт
+void parseArguments(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        string option = argv[i];
+        if (option == "range" && i + 2 < argc) {
+            rangeBegin = stoll(argv[i + 1]);
+            rangeEnd = stoll(argv[i + 2]);
+            i += 2;
+        } else if (option == "shard" && i + 2 < argc) {
+            shardIndex = stoi(argv[i + 1]);
+            numberOfShards = stoi(argv[i + 2]);
+            i += 2;
+        } else if (option == "checkpoint" && i + 1 < argc) {
+            checkpointFile = argv[i + 1];
+            i += 1;
+        } else if (option == "merge" && i + 1 < argc) {
+            mergeFiles.assign(argv + i + 1, argv + argc);
+            i = argc;
+        } else {
+            cout << "usage: " << argv[0] << " [range <begin> <end> | shard <i> <k>] [checkpoint <file>] | merge <file>..." << endl;
+            exit(1);
+        }
+    }
+    assert(rangeBegin >= 0 && (rangeEnd == -1 || rangeBegin <= rangeEnd));
+    assert(shardIndex >= 0 && shardIndex < numberOfShards);
+}
+
+int main(int argc, char* argv[]) {
+    parseArguments(argc, argv);
     inputParameters();
     initData();
-    generate();
+    if (mergeFiles.empty()) {
+        generate();
+    } else {
+        mergeCheckpoints();
+    }
+    if (BUDGET_OPTIMIZATION == 2) {
+        retryUndecidedSets();
+    }
     outputResults();
     answerForQueries();
     return 0;
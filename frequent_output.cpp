@@ -1,197 +1,534 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 using namespace std;
 
 namespace Solver{
-    int numberOfTiles; // количество тайлов
-    int maximumSize; // максимальный размер квадрата, который проверяем
-    vector<vector<int>> tiles; // заданный набор тайлов 
-
     // Перебор направлений
     // x - столбцы, y - строки
     // противоположный - ^ 2
     const vector<int> dx = {-1, 0, 1, 0}; // up, right, down, left
     const vector<int> dy = {0, 1, 0, -1};  
 
-    bool isSame(int type1, int type2, int dir1) {
-        return tiles[type1][dir1] == tiles[type2][dir1 ^ 2];
+    // Клетка прямоугольника, пустая клетка - EMPTY_CELL
+    // Если вдруг numberOfTiles будет >= 255 - нужно поставить Cell = uint16_t
+    typedef uint8_t Cell;
+    const Cell EMPTY_CELL = numeric_limits<Cell>::max();
+
+    // Прямоугольник внутри плоского буфера: n строк по m клеток подряд
+    struct TableView {
+        const Cell* cells;
+        int n;
+        int m;
+
+        Cell get(int x, int y) const {
+            return cells[x * m + y];
+        }
+    };
+
+    vector<vector<int>> toMatrix(const TableView& table) {
+        vector<vector<int>> matrix(table.n, vector<int>(table.m));
+        for (int x = 0; x < table.n; ++x) {
+            for (int y = 0; y < table.m; ++y) {
+                matrix[x][y] = table.get(x, y);
+            }
+        }
+        return matrix;
     }
 
-    // Проверка замощённого прямоугольника - является ли он периодом
-    bool isTilingRectangle(const vector<vector<int>>& table) {
-        assert(!table.empty());
-        int n = table.size();
-        assert(!table[0].empty());
-        int m = table[0].size();
+    // Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
+    const int N = 123;
+
+    // Перебирать или не перебирать периоды x * 1 (1 - да, 2 - нет)
+    const int FIRST_SQUARE_OPTIMIZATION = 2;
+
+    // Перебирать или не перебирать периоды n * m, n < m (1 - да, 2 - нет)
+    const int LEXICOGRAPHIC_OPTIMIZATION = 1;
+
+    // Перед заполнением полоски сужать домены её клеток до тайлов, с которых полоска дозаполняется (1 - нет, 2 - да)
+    const int FORWARD_CHECKING_OPTIMIZATION = 2;
+
+    // Освобождать allTables[h - 1][w - 1], как только построен allTables[h][w] (1 - нет, 2 - да)
+    // Живут только две соседние строки корзин, а лучший незамощаемый прямоугольник запоминается сразу
+    const int ROLLING_FRONTIER_OPTIMIZATION = 2;
+
+    // Хранить прямоугольники с одинаковой границей один раз (1 - нет, 2 - да)
+    // Продолжение прямоугольника зависит только от последней строки и столбца, проверка периода -
+    // от первых и последних, так что из прямоугольников с одинаковой границей остаётся первый
+    const int BOUNDARY_OPTIMIZATION = 2;
+
+    // Перебирать размеры прямоугольников по возрастанию площади, при равной - периметра, а не по строкам (1 - нет, 2 - да)
+    // Первым находится период наименьшей площади, поэтому найденный период может отличаться от перебора по строкам
+    const int AREA_ORDER_OPTIMIZATION = 1;
+
+    // При том же числе тайлов не строить маски совместимости заново, а пересчитывать только позиции,
+    // где тайл поменялся по сравнению с прошлым solve() (1 - нет, 2 - да)
+    const int INCREMENTAL_TILES_OPTIMIZATION = 2;
+
+    // Всё состояние одного решателя. Контекст переиспользуется между вызовами solve():
+    // буферы сохраняют ёмкость, а чистится только та часть allTables, которую занял прошлый запуск.
+    // Контексты независимы, поэтому несколько штук могут работать одновременно в разных потоках.
+    // Внутри лежит allTables[N][N], так что контекст лучше создавать в куче или статически
+    class SolverContext {
+    public:
+        // Эта часть для внешнего доступа, запускает Solver на заданном наборе тайлов и выдаёт требуемые ответы
+        void solve(
+            const int _numberOfTiles,
+            const int _maximumSize,
+            const vector<vector<int>>& _tiles,
+            bool& _foundPeriod,
+            vector<vector<int>>& _minimumTilingRectangle,
+            vector<vector<int>>& _maximumTiledRectangle
+            ) {
+            numberOfTiles = _numberOfTiles;
+            maximumSize = _maximumSize;
+            assert(numberOfTiles < EMPTY_CELL);
+            setTiles(_tiles);
+            run();
+            _foundPeriod = foundPeriod;
+            _minimumTilingRectangle = minimumTilingRectangle;
+            _maximumTiledRectangle = maximumTiledRectangle;
+        }
+
+    private:
+        int numberOfTiles; // количество тайлов
+        int maximumSize; // максимальный размер квадрата, который проверяем
+        vector<vector<int>> tiles; // заданный набор тайлов 
+
+        bool isSame(int type1, int type2, int dir1) {
+            return tiles[type1][dir1] == tiles[type2][dir1 ^ 2];
+        }
+
+        // Проверка замощённого прямоугольника - является ли он периодом
+        bool isTilingRectangle(const TableView& table) {
+            assert(table.n > 0);
+            int n = table.n;
+            assert(table.m > 0);
+            int m = table.m;
+
+            for (int x = 0; x < n; ++x) {
+                // table[x][0][3] != table[x][m - 1][1]
+                if (!isSame(table.get(x, 0), table.get(x, m - 1), 3)) {
+                    return false;
+                }
+            }
+
+            for (int y = 0; y < m; ++y) {
+                // table[0][y][0] != table[n - 1][y][2]
+                if (!isSame(table.get(0, y), table.get(n - 1, y), 0)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Проверка для точки на принадлежность bounding box
+        bool isInTable(const TableView& table, int x, int y) {
+            return x >= 0 && x < table.n && y >= 0 && y < table.m;
+        }
 
-        for (int x = 0; x < n; ++x) {
-            // table[x][0][3] != table[x][m - 1][1]
-            if (!isSame(table[x][0], table[x][m - 1], 3)) {
-                return false;
+        // Маски совместимости, строятся на solve() (или обновляются в setTiles)
+        // бит type в слове compatibleMask[dir][other * maskWords + type / 64] стоит, если тайл type
+        // можно поставить так, чтобы тайл other оказался его соседом в направлении dir
+        int maskWords;
+        vector<unsigned long long> compatibleMask[4];
+
+        void buildCompatibleMasks() {
+            maskWords = (numberOfTiles + 63) / 64;
+            for (int dir = 0; dir < 4; ++dir) {
+                compatibleMask[dir].assign(numberOfTiles * maskWords, 0);
+                for (int other = 0; other < numberOfTiles; ++other) {
+                    for (int type = 0; type < numberOfTiles; ++type) {
+                        if (isSame(type, other, dir)) {
+                            compatibleMask[dir][other * maskWords + type / 64] |= 1ULL << (type % 64);
+                        }
+                    }
+                }
             }
         }
 
-        for (int y = 0; y < m; ++y) {
-            // table[0][y][0] != table[n - 1][y][2]
-            if (!isSame(table[0][y], table[n - 1][y], 0)) {
-                return false;
+        // Пересчитывает в масках совместимости всё, что касается тайлов changed: их строки и их биты в остальных строках
+        void updateCompatibleMasks(const vector<int>& changed) {
+            for (int dir = 0; dir < 4; ++dir) {
+                for (int type : changed) {
+                    for (int word = 0; word < maskWords; ++word) {
+                        compatibleMask[dir][type * maskWords + word] = 0;
+                    }
+                    for (int other = 0; other < numberOfTiles; ++other) {
+                        if (isSame(other, type, dir)) {
+                            compatibleMask[dir][type * maskWords + other / 64] |= 1ULL << (other % 64);
+                        }
+                        unsigned long long& word = compatibleMask[dir][other * maskWords + type / 64];
+                        if (isSame(type, other, dir)) {
+                            word |= 1ULL << (type % 64);
+                        } else {
+                            word &= ~(1ULL << (type % 64));
+                        }
+                    }
+                }
             }
         }
 
-        return true;
-    }
+        vector<int> changedTiles; // буфер setTiles
 
-    // Проверка для точки на принадлежность bounding box
-    bool isInTable(const vector<vector<int>>& table, int x, int y) {
-        if (table.empty() || table[0].empty()) {
-            return false;
+        // Соседние наборы перебора обычно отличаются несколькими последними тайлами, поэтому
+        // при том же размере набора копируются и пересчитываются только поменявшиеся позиции
+        void setTiles(const vector<vector<int>>& _tiles) {
+            if (INCREMENTAL_TILES_OPTIMIZATION == 1 || tiles.size() != _tiles.size()) {
+                tiles = _tiles;
+                buildCompatibleMasks();
+                return;
+            }
+            changedTiles.clear();
+            for (int type = 0; type < numberOfTiles; ++type) {
+                if (tiles[type] != _tiles[type]) {
+                    tiles[type] = _tiles[type];
+                    changedTiles.push_back(type);
+                }
+            }
+            updateCompatibleMasks(changedTiles);
         }
 
-        return x >= 0 && x < (int)table.size() && y >= 0 && y < (int)table[0].size();
-    }
+        // Маска тайлов из слова word, которые можно поставить в данную точку
+        unsigned long long getCandidates(const TableView& table, int x, int y, int word) {
+            assert(isInTable(table, x, y));
 
-    // Проверка для тайла можно ли его поставить в данную точку
-    bool canPutTile(const vector<vector<int>>& table, int x, int y, int type) {
-        //cout << "x = " << x << " y = " << y << endl;
-        assert(isInTable(table, x, y));
+            unsigned long long candidates = ~0ULL;
+            if (word == maskWords - 1 && numberOfTiles % 64 != 0) {
+                candidates = (1ULL << (numberOfTiles % 64)) - 1;
+            }
 
-        for (int dir = 0; dir < 4; ++dir) {
-            int nx = x + dx[dir];
-            int ny = y + dy[dir];
-            if (!isInTable(table, nx, ny)) continue;
-            if (table[nx][ny] == -1) continue;
-            if (!isSame(type, table[nx][ny], dir)) {
-                return false;
+            for (int dir = 0; dir < 4 && candidates; ++dir) {
+                int nx = x + dx[dir];
+                int ny = y + dy[dir];
+                if (!isInTable(table, nx, ny)) continue;
+                if (table.get(nx, ny) == EMPTY_CELL) continue;
+                candidates &= compatibleMask[dir][table.get(nx, ny) * maskWords + word];
             }
+
+            return candidates;
         }
 
-        return true;
-    }
+        // конструкции вида: vector<vector<vector<vector<vector<int>>>>> - это смерть, 3 - тоже плохо, но не совсем смерть
+        // поэтому все прямоугольники h * w лежат подряд в одном буфере allTables[h][w]
+        vector<Cell> allTables[N][N];
+        vector<Cell> currentTable; // прямоугольник, который сейчас заполняет recTryToAdd
+        vector<vector<int>> minimumTilingRectangle;
+        vector<vector<int>> maximumTiledRectangle;
+        bool foundPeriod;
+        int usedSize = 0; // до какого размера заняты allTables с прошлого запуска
+        // последний в порядке по строкам (h, затем w) незамощаемый прямоугольник с w <= h:
+        // lastH = 0 - его нет, lastIndex = -1 - его нет или он уже скопирован в maximumTiledRectangle
+        int lastH, lastW, lastIndex;
+        // Открытая адресация по хешу границы: номера прямоугольников заполняемого allTables[h][w], -1 - пусто
+        vector<int> boundaryTable;
+        int numberOfBoundaries = 0;
+
+        // Хеш первой и последней строк, первого и последнего столбцов
+        unsigned long long getBoundaryHash(const TableView& table) {
+            unsigned long long hash = 14695981039346656037ULL;
+            for (int y = 0; y < table.m; ++y) {
+                hash = (hash ^ table.get(0, y)) * 1099511628211ULL;
+                hash = (hash ^ table.get(table.n - 1, y)) * 1099511628211ULL;
+            }
+            for (int x = 0; x < table.n; ++x) {
+                hash = (hash ^ table.get(x, 0)) * 1099511628211ULL;
+                hash = (hash ^ table.get(x, table.m - 1)) * 1099511628211ULL;
+            }
+            return hash;
+        }
 
-    // конструкции вида: vector<vector<vector<vector<vector<int>>>>> - это смерть, 3 - тоже плохо, но не совсем смерть
-    // Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
-    const int N = 123;
-    vector<vector<vector<int>>> allTables[N][N];
-    vector<vector<int>> minimumTilingRectangle;
-    vector<vector<int>> maximumTiledRectangle;
-    bool foundPeriod;
+        bool isSameBoundary(const TableView& table1, const TableView& table2) {
+            for (int y = 0; y < table1.m; ++y) {
+                if (table1.get(0, y) != table2.get(0, y) || table1.get(table1.n - 1, y) != table2.get(table2.n - 1, y)) {
+                    return false;
+                }
+            }
+            for (int x = 0; x < table1.n; ++x) {
+                if (table1.get(x, 0) != table2.get(x, 0) || table1.get(x, table1.m - 1) != table2.get(x, table2.m - 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
 
-    // Обновить ответы замощённым прямоугольником
-    void relaxAnswers(const vector<vector<int>>& table) {
-        if (isTilingRectangle(table)) {
-            minimumTilingRectangle = table;
-            foundPeriod = true;
+        void clearBoundaries() {
+            boundaryTable.assign(16, -1);
+            numberOfBoundaries = 0;
         }
-        allTables[table.size()][table[0].size()].push_back(table);
-    }
 
-    // Рекурсивная штука пытается заполнить полоску от таблички (из -1)
-    //  0  1 -1
-    //  1  2 -1
-    // -1 -1 -1
-    void recTryToAdd(vector<vector<int>>& table, int x, int y) {
-        if (x == -1) {
-            relaxAnswers(table);
-        } else {
-            assert(!table.empty());
-            assert(!table[0].empty());
-            int m = table[0].size();
-
-            int nx = x, ny = y;
-            if (ny + 1 < m) {
-                ++ny;
-            } else {
-                --nx;
+        void insertBoundary(int h, int w, int index) {
+            size_t mask = boundaryTable.size() - 1;
+            size_t cell = getBoundaryHash(getTable(h, w, index)) & mask;
+            while (boundaryTable[cell] != -1) {
+                cell = (cell + 1) & mask;
             }
+            boundaryTable[cell] = index;
+        }
 
-            for (int type = 0; type < numberOfTiles; ++type) {
-                if (!canPutTile(table, x, y, type)) continue;
-                
-                table[x][y] = type;
-                recTryToAdd(table, nx, ny);
-                table[x][y] = -1;
+        // Есть ли в allTables[table.n][table.m] прямоугольник с такой же границей, если нет - запоминает,
+        // что table будет лежать там под номером countTables(table.n, table.m)
+        bool isKnownBoundary(const TableView& table) {
+            int h = table.n, w = table.m;
+            if (h < 3 || w < 3) {
+                return false; // внутренности нет, граница - весь прямоугольник
+            }
+            if (2 * (numberOfBoundaries + 1) > (int)boundaryTable.size()) {
+                boundaryTable.assign(2 * boundaryTable.size(), -1);
+                for (int index = 0; index < numberOfBoundaries; ++index) {
+                    insertBoundary(h, w, index);
+                }
             }
+            size_t mask = boundaryTable.size() - 1;
+            size_t cell = getBoundaryHash(table) & mask;
+            while (boundaryTable[cell] != -1) {
+                if (isSameBoundary(getTable(h, w, boundaryTable[cell]), table)) {
+                    return true;
+                }
+                cell = (cell + 1) & mask;
+            }
+            boundaryTable[cell] = numberOfBoundaries++;
+            return false;
         }
-    }    
 
-    // Расширяет прямоугольник в нужную сторону и запускает рекурсию
-    void tryToAdd(const vector<vector<int>>& baseTable, int n, int m) {
-        auto table = baseTable;
-        for (int x = 0; x < n; ++x) {
-            if (table.size() == x) {
-                table.push_back(vector<int>(m, -1));
+        // Количество прямоугольников h * w (прямоугольник с нулевой стороной ровно один - пустой)
+        int countTables(int h, int w) {
+            if (h == 0 || w == 0) {
+                return 1;
             }
-            while (table[x].size() < m) {
-                table[x].push_back(-1);
+            return allTables[h][w].size() / (h * w);
+        }
+
+        TableView getTable(int h, int w, int index) {
+            return {allTables[h][w].data() + (size_t)index * h * w, h, w};
+        }
+
+        // Освободить память allTables[h][w], перед этим скопировав из него последний незамощаемый прямоугольник
+        void freeTables(int h, int w) {
+            if (lastIndex != -1 && lastH == h && lastW == w) {
+                maximumTiledRectangle = toMatrix(getTable(h, w, lastIndex));
+                lastIndex = -1;
             }
+            vector<Cell>().swap(allTables[h][w]);
         }
 
-        recTryToAdd(table, n - 1, 0);
-    }
+        // Обновить ответы замощённым прямоугольником
+        void relaxAnswers(const TableView& table) {
+            if (BOUNDARY_OPTIMIZATION == 2 && isKnownBoundary(table)) {
+                return;
+            }
+            if (isTilingRectangle(table)) {
+                minimumTilingRectangle = toMatrix(table);
+                foundPeriod = true;
+            } else if (ROLLING_FRONTIER_OPTIMIZATION == 2 && table.m <= table.n) {
+                // размеры могут строиться не по строкам (AREA_ORDER), а ответ - последний по строкам
+                if (table.n > lastH || (table.n == lastH && table.m >= lastW)) {
+                    lastH = table.n, lastW = table.m, lastIndex = countTables(table.n, table.m);
+                }
+            }
+            auto& bucket = allTables[table.n][table.m];
+            bucket.insert(bucket.end(), table.cells, table.cells + table.n * table.m);
+        }
 
-    // Перебирать или не перебирать периоды x * 1 (1 - да, 2 - нет)
-    const int FIRST_SQUARE_OPTIMIZATION = 2;
+        // Домены клеток полоски: stripDomains[i * maskWords + word] - тайлы из слова word,
+        // которые можно поставить в i-ю по порядку заполнения клетку так, чтобы полоска дозаполнилась
+        vector<unsigned long long> stripDomains;
 
-    // Перебирать или не перебирать периоды n * m, n < m (1 - да, 2 - нет)
-    const int LEXICOGRAPHIC_OPTIMIZATION = 1;
+        // Порядок заполнения полоски: нижняя строка слева направо, потом правый столбец снизу вверх
+        int getStripIndex(const TableView& table, int x, int y) {
+            return x == table.n - 1 ? y : table.m - 1 + (table.n - 1 - x);
+        }
+
+        // В полоске каждая клетка соседствует только с предыдущей и следующей, поэтому одного прохода
+        // с конца хватает, чтобы в доменах остались ровно дозаполняемые тайлы: перебор не заходит в тупики,
+        // а клетки с одним вариантом проходятся без ветвления. false - полоску заполнить нельзя
+        bool buildStripDomains(const TableView& table) {
+            int length = table.n + table.m - 1;
+            stripDomains.assign(length * maskWords, 0);
+            for (int i = length - 1; i >= 0; --i) {
+                int x = i < table.m ? table.n - 1 : table.n - 1 - (i - (table.m - 1));
+                int y = i < table.m ? i : table.m - 1;
+                unsigned long long* domain = &stripDomains[i * maskWords];
+                if (i + 1 < length) {
+                    int dir = i + 1 < table.m ? 1 : 0; // следующая клетка справа или сверху
+                    const unsigned long long* nextDomain = &stripDomains[(i + 1) * maskWords];
+                    for (int word = 0; word < maskWords; ++word) {
+                        unsigned long long next = nextDomain[word];
+                        while (next) {
+                            int type = word * 64 + __builtin_ctzll(next);
+                            next &= next - 1;
+                            for (int to = 0; to < maskWords; ++to) {
+                                domain[to] |= compatibleMask[dir][type * maskWords + to];
+                            }
+                        }
+                    }
+                } else {
+                    for (int word = 0; word < maskWords; ++word) {
+                        domain[word] = ~0ULL;
+                    }
+                }
+                bool isEmpty = true;
+                for (int word = 0; word < maskWords; ++word) {
+                    domain[word] &= getCandidates(table, x, y, word);
+                    isEmpty &= domain[word] == 0;
+                }
+                if (isEmpty) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Рекурсивная штука пытается заполнить полоску от таблички (из EMPTY_CELL)
+        //  0  1 -1
+        //  1  2 -1
+        // -1 -1 -1
+        void recTryToAdd(const TableView& table, int x, int y) {
+            if (x == -1) {
+                relaxAnswers(table);
+            } else {
+                int m = table.m;
 
-    // main
-    void run() {
-        for (int h = 0; h <= maximumSize; ++h) {
-            for (int w = 0; w <= maximumSize; ++w) {
-                allTables[h][w].clear();
-                if (h == 0 || w == 0) {
-                    allTables[h][w].push_back(vector<vector<int>>());
+                int nx = x, ny = y;
+                if (ny + 1 < m) {
+                    ++ny;
+                } else {
+                    --nx;
+                }
+
+                for (int word = 0; word < maskWords; ++word) {
+                    unsigned long long candidates = getCandidates(table, x, y, word);
+                    if (FORWARD_CHECKING_OPTIMIZATION == 2) {
+                        candidates &= stripDomains[getStripIndex(table, x, y) * maskWords + word];
+                    }
+                    while (candidates) {
+                        int type = word * 64 + __builtin_ctzll(candidates);
+                        candidates &= candidates - 1;
+
+                        currentTable[x * m + y] = type;
+                        recTryToAdd(table, nx, ny);
+                        currentTable[x * m + y] = EMPTY_CELL;
+                    }
                 }
             }
-        } 
+        }    
+
+        // Расширяет прямоугольник в нужную сторону и запускает рекурсию
+        void tryToAdd(const TableView& baseTable, int n, int m) {
+            currentTable.assign(n * m, EMPTY_CELL);
+            for (int x = 0; x < baseTable.n; ++x) {
+                for (int y = 0; y < baseTable.m; ++y) {
+                    currentTable[x * m + y] = baseTable.get(x, y);
+                }
+            }
+
+            TableView table = {currentTable.data(), n, m};
+            if (FORWARD_CHECKING_OPTIMIZATION == 2 && !buildStripDomains(table)) {
+                return;
+            }
+            recTryToAdd(table, n - 1, 0);
+        }
+
+        // main
+        // Достраивает allTables[h][w] из allTables[h - 1][w - 1]
+        void buildShape(int h, int w) {
+            clearBoundaries();
+            for (int index = 0; index < countTables(h - 1, w - 1); ++index) {
+                if (foundPeriod) {
+                    break;
+                } else {
+                    tryToAdd(getTable(h - 1, w - 1, index), h, w);
+                }
+            }
+            if (ROLLING_FRONTIER_OPTIMIZATION == 2) {
+                freeTables(h - 1, w - 1);
+            }
+        }
+
+        // Размеры из shapes по возрастанию площади, при равной - периметра. Размер попадает в очередь,
+        // когда построена его основа allTables[h - 1][w - 1] или основы нет среди shapes, так что основа
+        // всегда готова, и каждая корзина по-прежнему нужна только следующему размеру по диагонали.
+        // За пустым размером его продолжения не строятся
+        void runAreaOrder(const vector<pair<int, int>>& shapes) {
+            vector<vector<char>> isShape(maximumSize + 2, vector<char>(maximumSize + 2, 0));
+            for (auto [h, w] : shapes) {
+                isShape[h][w] = 1;
+            }
+            priority_queue<tuple<int, int, int>, vector<tuple<int, int, int>>, greater<tuple<int, int, int>>> order;
+            for (auto [h, w] : shapes) {
+                if (!isShape[h - 1][w - 1]) {
+                    order.push({h * w, h + w, h});
+                }
+            }
+            while (!order.empty() && !foundPeriod) {
+                auto [area, perimeter, h] = order.top();
+                order.pop();
+                int w = area / h;
+                buildShape(h, w);
+                if (countTables(h, w) > 0 && isShape[h + 1][w + 1]) {
+                    order.push({(h + 1) * (w + 1), h + w + 2, h + 1});
+                }
+            }
+        }
+
+        void run() {
+            for (int h = 0; h <= usedSize; ++h) {
+                for (int w = 0; w <= usedSize; ++w) {
+                    allTables[h][w].clear();
+                }
+            } 
+            usedSize = maximumSize;
 
-        foundPeriod = false;
+            foundPeriod = false;
+            maximumTiledRectangle.clear();
+            lastH = 0, lastW = 0, lastIndex = -1;
 
-        for (int h = 1; h <= maximumSize && !foundPeriod; ++h) {
-            for (int w = min(h, FIRST_SQUARE_OPTIMIZATION); w <= (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h) && !(FIRST_SQUARE_OPTIMIZATION == 2 && h == 1 && w > 1) && !foundPeriod; ++w) {
-                assert(!(h == 1 && w > 1));
-                for (const auto& baseTable : allTables[h - 1][w - 1]) {
+            vector<pair<int, int>> shapes;
+            for (int h = 1; h <= maximumSize; ++h) {
+                for (int w = min(h, FIRST_SQUARE_OPTIMIZATION); w <= (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h) && !(FIRST_SQUARE_OPTIMIZATION == 2 && h == 1 && w > 1); ++w) {
+                    shapes.push_back({h, w});
+                }
+            }
+            if (AREA_ORDER_OPTIMIZATION == 2) {
+                runAreaOrder(shapes);
+            } else {
+                for (auto [h, w] : shapes) {
                     if (foundPeriod) {
                         break;
-                    } else {
-                        tryToAdd(baseTable, h, w);
                     }
+                    buildShape(h, w);
                 }
             }
-        }
 
-        for (int h = 1; h <= maximumSize; ++h) {
-            for (int w = 1; w <= h; ++w) {
-                for (const auto& table : allTables[h][w]) {
-                    if (!isTilingRectangle(table)) {
-                        maximumTiledRectangle = table;
+            if (ROLLING_FRONTIER_OPTIMIZATION == 1) {
+                lastIndex = -1;
+                for (int h = 1; h <= maximumSize; ++h) {
+                    for (int w = 1; w <= h; ++w) {
+                        for (int index = 0; index < countTables(h, w); ++index) {
+                            if (!isTilingRectangle(getTable(h, w, index))) {
+                                lastIndex = index, lastH = h, lastW = w;
+                            }
+                        }
                     }
                 }
             }
+            if (lastIndex != -1) {
+                maximumTiledRectangle = toMatrix(getTable(lastH, lastW, lastIndex));
+            }
         }
-    }
-
-    // Эта часть для внешнего доступа, запускает Solver на заданном наборе тайлов и выдаёт требуемые ответы
-    void solve(
-        const int _numberOfTiles,
-        const int _maximumSize,
-        const vector<vector<int>>& _tiles,
-        bool& _foundPeriod,
-        vector<vector<int>>& _minimumTilingRectangle,
-        vector<vector<int>>& _maximumTiledRectangle
-        ) {
-        numberOfTiles = _numberOfTiles;
-        maximumSize = _maximumSize;
-        tiles = _tiles;
-        run();
-        _foundPeriod = foundPeriod;
-        _minimumTilingRectangle = minimumTilingRectangle;
-        _maximumTiledRectangle = maximumTiledRectangle;
-    }
+    };
 };
 
 int numberOfTiles;
@@ -207,37 +544,96 @@ void inputParameters() {
     assert(maximumSize < N);
 }
 
-int numberOfAllSets;
+// С учётом весов классов симметрии, поэтому long long
+atomic<long long> numberOfAllSets;
+atomic<long long> numberOfSolvedSets; // сколько раз реально запускали Solver
+
+atomic<long long> numberOfAllTilingSets;
+atomic<long long> numberOfAllNonTilingSets;
+
+// Гистограммы и примеры наборов
+// При параллельном переборе у каждого потока своя статистика, в конце они складываются в results
+struct Statistics {
+    long long numberOfTilingSets[N][N];
+    long long numberOfNonTilingSets[N][N];
+
+    vector<vector<int>> sampleTilingSet[N][N];
+    vector<vector<int>> sampleTilingRectangle[N][N];
+    int sampleTilingOrder[N][N]; // номер задачи, из которой взят пример
+
+    vector<vector<int>> sampleNonTilingSet[N][N];
+    vector<vector<int>> sampleNonTilingRectangle[N][N];
+    int sampleNonTilingOrder[N][N];
+
+    void clear() {
+        for (int h = 0; h < N; ++h) {
+            for (int w = 0; w < N; ++w) {
+                numberOfTilingSets[h][w] = 0;
+                numberOfNonTilingSets[h][w] = 0;
+
+                sampleTilingSet[h][w] = {};
+                sampleTilingRectangle[h][w] = {};
+                sampleTilingOrder[h][w] = 0;
+
+                sampleNonTilingSet[h][w] = {};
+                sampleNonTilingRectangle[h][w] = {};
+                sampleNonTilingOrder[h][w] = 0;
+            }
+        }
+    }
+
+    // Добавить чужую статистику, из двух примеров остаётся тот, что раньше в последовательном переборе
+    void merge(const Statistics& other) {
+        for (int h = 0; h < N; ++h) {
+            for (int w = 0; w < N; ++w) {
+                if (other.numberOfTilingSets[h][w] != 0) {
+                    if (numberOfTilingSets[h][w] == 0 || other.sampleTilingOrder[h][w] < sampleTilingOrder[h][w]) {
+                        sampleTilingSet[h][w] = other.sampleTilingSet[h][w];
+                        sampleTilingRectangle[h][w] = other.sampleTilingRectangle[h][w];
+                        sampleTilingOrder[h][w] = other.sampleTilingOrder[h][w];
+                    }
+                    numberOfTilingSets[h][w] += other.numberOfTilingSets[h][w];
+                }
+                if (other.numberOfNonTilingSets[h][w] != 0) {
+                    if (numberOfNonTilingSets[h][w] == 0 || other.sampleNonTilingOrder[h][w] < sampleNonTilingOrder[h][w]) {
+                        sampleNonTilingSet[h][w] = other.sampleNonTilingSet[h][w];
+                        sampleNonTilingRectangle[h][w] = other.sampleNonTilingRectangle[h][w];
+                        sampleNonTilingOrder[h][w] = other.sampleNonTilingOrder[h][w];
+                    }
+                    numberOfNonTilingSets[h][w] += other.numberOfNonTilingSets[h][w];
+                }
+            }
+        }
+    }
+};
 
-int numberOfAllTilingSets;
-int numberOfAllNonTilingSets;
+Statistics results;
 
-int numberOfTilingSets[N][N];
-int numberOfNonTilingSets[N][N];
+// Всё, что нужно одному потоку перебора: свой решатель и своя статистика
+struct Worker {
+    Solver::SolverContext solver;
+    Statistics statistics;
 
-vector<vector<int>> sampleTilingSet[N][N];
-vector<vector<int>> sampleTilingRectangle[N][N];
+    Worker() {
+        statistics.clear();
+    }
+};
 
-vector<vector<int>> sampleNonTilingSet[N][N];
-vector<vector<int>> sampleNonTilingRectangle[N][N];
+bool printedMinimumPeriod[N][N]; // про какие периоды уже написали "new minimum period"
 
 // Инициализирует все массивы и счётчики
 void initData() {
     numberOfAllSets = 0;
+    numberOfSolvedSets = 0;
 
     numberOfAllTilingSets = 0;
     numberOfAllNonTilingSets = 0;
 
+    results.clear();
+
     for (int h = 0; h < N; ++h) {
         for (int w = 0; w < N; ++w) {
-            numberOfTilingSets[h][w] = 0;
-            numberOfNonTilingSets[h][w] = 0;
-
-            sampleTilingSet[h][w] = {};
-            sampleTilingRectangle[h][w] = {};
-
-            sampleNonTilingSet[h][w] = {};
-            sampleNonTilingRectangle[h][w] = {};
+            printedMinimumPeriod[h][w] = false;
         }
     }
 }
@@ -260,25 +656,34 @@ void genAllTiles(vector<int> tile) {
 
 const int OUTPUT_EVERY_CONST_ITERATIONS = 10000;
 
-// Обновить ответы заданным набором тайлов
-void relaxAnswers(const vector<vector<int>>& tiles) {
+mutex outputMutex;
+
+// Обновить ответы заданным набором тайлов, order - номер задачи, в которой найден набор,
+// weight - сколько наборов он представляет (размер класса симметрии)
+void relaxAnswers(const vector<vector<int>>& tiles, Worker& worker, int order, long long weight) {
+    Statistics& statistics = worker.statistics;
     bool foundPeriod = false;
     vector<vector<int>> minimumTilingRectangle;
     vector<vector<int>> maximumTiledRectangle;
-    Solver::solve(numberOfTiles, maximumSize, tiles, foundPeriod, minimumTilingRectangle, maximumTiledRectangle);
+    worker.solver.solve(numberOfTiles, maximumSize, tiles, foundPeriod, minimumTilingRectangle, maximumTiledRectangle);
     if (foundPeriod) {
-        ++numberOfAllTilingSets;
+        numberOfAllTilingSets += weight;
         assert(!minimumTilingRectangle.empty());
         int h = minimumTilingRectangle.size();
         assert(!minimumTilingRectangle[0].empty());
         int w = minimumTilingRectangle[0].size();
-        ++numberOfTilingSets[h][w];
-        if (numberOfTilingSets[h][w] == 1) {
-            sampleTilingSet[h][w] = tiles;
-            sampleTilingRectangle[h][w] = minimumTilingRectangle;
+        if (statistics.numberOfTilingSets[h][w] == 0 || order < statistics.sampleTilingOrder[h][w]) {
+            statistics.sampleTilingSet[h][w] = tiles;
+            statistics.sampleTilingRectangle[h][w] = minimumTilingRectangle;
+            statistics.sampleTilingOrder[h][w] = order;
+        }
+        statistics.numberOfTilingSets[h][w] += weight;
+        lock_guard<mutex> lock(outputMutex);
+        if (!printedMinimumPeriod[h][w]) {
+            printedMinimumPeriod[h][w] = true;
             cout << "new minimum period: h = " << h << " w = " << w << endl;
             cout << "sample set" << endl;
-            for (auto tile : sampleTilingSet[h][w]) {
+            for (auto tile : tiles) {
                 for (auto side : tile) {
                     cout << side << " ";
                 }
@@ -287,26 +692,29 @@ void relaxAnswers(const vector<vector<int>>& tiles) {
             cout << "minimum period for sample set" << endl;
             for (int x = 0; x < h; ++x) {
                 for (int y = 0; y < w; ++y) {
-                    cout << static_cast<char>('A' + sampleTilingRectangle[h][w][x][y]);
+                    cout << static_cast<char>('A' + minimumTilingRectangle[x][y]);
                 }
                 cout << endl;
             }
         }
     } else {
-        ++numberOfAllNonTilingSets;
+        numberOfAllNonTilingSets += weight;
         assert(!maximumTiledRectangle.empty());
         int h = maximumTiledRectangle.size();
         assert(!maximumTiledRectangle[0].empty());
         int w = maximumTiledRectangle[0].size();
-        ++numberOfNonTilingSets[h][w];
-        if (numberOfNonTilingSets[h][w] == 1) {
-            sampleNonTilingSet[h][w] = tiles;
-            sampleNonTilingRectangle[h][w] = maximumTiledRectangle;
+        if (statistics.numberOfNonTilingSets[h][w] == 0 || order < statistics.sampleNonTilingOrder[h][w]) {
+            statistics.sampleNonTilingSet[h][w] = tiles;
+            statistics.sampleNonTilingRectangle[h][w] = maximumTiledRectangle;
+            statistics.sampleNonTilingOrder[h][w] = order;
         }
+        statistics.numberOfNonTilingSets[h][w] += weight;
     }
-    ++numberOfAllSets;
-    if (numberOfAllSets % OUTPUT_EVERY_CONST_ITERATIONS == 0) {
-        cout << "Checked first " << numberOfAllSets << " sets" << endl;
+    ++numberOfSolvedSets;
+    long long checkedSets = numberOfAllSets += weight;
+    if (checkedSets / OUTPUT_EVERY_CONST_ITERATIONS != (checkedSets - weight) / OUTPUT_EVERY_CONST_ITERATIONS) {
+        lock_guard<mutex> lock(outputMutex);
+        cout << "Checked first " << checkedSets << " sets" << endl;
         cout << "Number of tiling sets = " << numberOfAllTilingSets << endl;
         cout << "Number of non tiling sets = " << numberOfAllNonTilingSets << endl;
         cout << endl;
@@ -314,14 +722,99 @@ void relaxAnswers(const vector<vector<int>>& tiles) {
 }
 
 // Первый тайл в наборе (0 0 <=1 <=1) (1 - нет, 2 - да)
-const int FIRST_OPTIMUM_TILE_OPTIMIZATION = 2; 
+// Грубая замена SYMMETRY_OPTIMIZATION, вместе с ней включать нельзя
+const int FIRST_OPTIMUM_TILE_OPTIMIZATION = 1; 
+
+// Проверять только один набор из каждого класса симметрии (1 - нет, 2 - да)
+// Симметрии - перестановки цветов вместе с отражениями (слева направо, сверху вниз, поворот на 180):
+// они не меняют ни размеры периодов, ни размеры замощаемых прямоугольников, поэтому
+// канонический (минимальный в классе) набор учитывается в статистике с весом = размер класса.
+// Поворот на 90 и транспонирование меняют h и w местами, а минимальный период ищется по возрастанию h,
+// так что ответ для повёрнутого набора из ответа для исходного не получается - такие наборы не склеиваются
+const int SYMMETRY_OPTIMIZATION = 2;
+
+static_assert(!(FIRST_OPTIMUM_TILE_OPTIMIZATION == 2 && SYMMETRY_OPTIMIZATION == 2), "FIRST_OPTIMUM_TILE_OPTIMIZATION breaks symmetry weights");
+
+// symmetries[g][код тайла] - код образа тайла при симметрии g, код тайла - его номер в allTiles
+vector<vector<int>> symmetries;
+
+int getTileCode(const vector<int>& tile) {
+    int code = 0;
+    for (int side : tile) {
+        code = code * numberOfColors + side;
+    }
+    return code;
+}
+
+void genSymmetries() {
+    vector<int> colors(numberOfColors);
+    for (int i = 0; i < numberOfColors; ++i) {
+        colors[i] = i;
+    }
+    do {
+        // flip & 1 - отражение слева направо, flip & 2 - сверху вниз
+        for (int flip = 0; flip < 4; ++flip) {
+            vector<int> image(allTiles.size());
+            for (int code = 0; code < (int)allTiles.size(); ++code) {
+                vector<int> tile = allTiles[code];
+                if (flip & 1) {
+                    swap(tile[1], tile[3]);
+                }
+                if (flip & 2) {
+                    swap(tile[0], tile[2]);
+                }
+                for (auto& side : tile) {
+                    side = colors[side];
+                }
+                image[code] = getTileCode(tile);
+            }
+            symmetries.push_back(image);
+        }
+    } while (next_permutation(colors.begin(), colors.end()));
+}
+
+// Размер класса симметрии набора или 0, если набор не минимальный в своём классе
+long long getSymmetryWeight(const vector<vector<int>>& tiles) {
+    vector<int> codes;
+    for (const auto& tile : tiles) {
+        codes.push_back(getTileCode(tile));
+    }
+    sort(codes.begin(), codes.end());
+    int stabilizer = 0;
+    vector<int> image(codes.size());
+    for (const auto& symmetry : symmetries) {
+        for (int i = 0; i < (int)codes.size(); ++i) {
+            image[i] = symmetry[codes[i]];
+        }
+        sort(image.begin(), image.end());
+        if (image < codes) {
+            return 0;
+        } else if (image == codes) {
+            ++stabilizer;
+        }
+    }
+    return symmetries.size() / stabilizer;
+}
+
+// Поддерево перебора, которое целиком отдаётся одному потоку
+struct Task {
+    vector<vector<int>> tiles;
+    int sizeOfSet;
+    int pos;
+};
 
 // Перебор всех наборов тайлов
-void recAllSetOfTiles(vector<vector<int>>& tiles, int sizeOfSet, int pos) {
-    if (sizeOfSet == numberOfTiles) {
-        relaxAnswers(tiles);    
+// Если tasks != nullptr, то поддеревья с pos == splitDepth не перебираются, а складываются в tasks
+void recAllSetOfTiles(vector<vector<int>>& tiles, int sizeOfSet, int pos, Worker& worker, int order, vector<Task>* tasks = nullptr, int splitDepth = 0) {
+    if (tasks != nullptr && (sizeOfSet == numberOfTiles || pos == splitDepth)) {
+        tasks->push_back({tiles, sizeOfSet, pos});
+    } else if (sizeOfSet == numberOfTiles) {
+        long long weight = SYMMETRY_OPTIMIZATION == 2 ? getSymmetryWeight(tiles) : 1;
+        if (weight != 0) {
+            relaxAnswers(tiles, worker, order, weight);
+        }
     } else if (pos < allTiles.size()) {
-        recAllSetOfTiles(tiles, sizeOfSet, pos + 1);
+        recAllSetOfTiles(tiles, sizeOfSet, pos + 1, worker, order, tasks, splitDepth);
         if (FIRST_OPTIMUM_TILE_OPTIMIZATION == 2) {
             if (sizeOfSet == 0) {
                 if (allTiles[pos][0] != 0 || allTiles[pos][1] != 0 || allTiles[pos][2] > 1 || allTiles[pos][3] > 1) {
@@ -330,7 +823,72 @@ void recAllSetOfTiles(vector<vector<int>>& tiles, int sizeOfSet, int pos) {
             }
         }
         tiles[sizeOfSet] = allTiles[pos];
-        recAllSetOfTiles(tiles, sizeOfSet + 1, pos + 1);
+        recAllSetOfTiles(tiles, sizeOfSet + 1, pos + 1, worker, order, tasks, splitDepth);
+    }
+}
+
+// Параллельный перебор на всех ядрах (1 - нет, 2 - да)
+const int PARALLEL_OPTIMIZATION = 2;
+
+// Глубина, на которой дерево перебора режется на задачи (до 2^TASK_SPLIT_DEPTH задач)
+const int TASK_SPLIT_DEPTH = 12;
+
+// Очередь задач одного потока, свободный поток ворует задачи с конца чужих очередей
+struct WorkQueue {
+    mutex queueMutex;
+    deque<int> tasks;
+};
+
+bool takeTask(vector<WorkQueue>& queues, int worker, int& task) {
+    {
+        lock_guard<mutex> lock(queues[worker].queueMutex);
+        if (!queues[worker].tasks.empty()) {
+            task = queues[worker].tasks.front();
+            queues[worker].tasks.pop_front();
+            return true;
+        }
+    }
+    for (int shift = 1; shift < (int)queues.size(); ++shift) {
+        auto& victim = queues[(worker + shift) % queues.size()];
+        lock_guard<mutex> lock(victim.queueMutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Параллельный перебор: дерево режется на задачи, у каждого потока свой Worker
+void parallelAllSetOfTiles() {
+    vector<vector<int>> tiles(numberOfTiles);
+    vector<Task> tasks;
+    auto splitter = make_unique<Worker>();
+    recAllSetOfTiles(tiles, 0, 0, *splitter, 0, &tasks, min<int>(TASK_SPLIT_DEPTH, allTiles.size()));
+
+    int numberOfWorkers = max(1u, thread::hardware_concurrency());
+    vector<WorkQueue> queues(numberOfWorkers);
+    for (int i = 0; i < (int)tasks.size(); ++i) {
+        queues[i % numberOfWorkers].tasks.push_back(i);
+    }
+
+    vector<unique_ptr<Worker>> workers(numberOfWorkers);
+    vector<thread> threads;
+    for (int worker = 0; worker < numberOfWorkers; ++worker) {
+        workers[worker] = make_unique<Worker>();
+        threads.emplace_back([&, worker]() {
+            int task;
+            while (takeTask(queues, worker, task)) {
+                recAllSetOfTiles(tasks[task].tiles, tasks[task].sizeOfSet, tasks[task].pos, *workers[worker], task);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& worker : workers) {
+        results.merge(worker->statistics);
     }
 }
 
@@ -339,8 +897,17 @@ void generate() {
     genAllTiles({});
     cout << "genAllTiles: ok, numer of tiles = " << allTiles.size() << endl;
     cout << endl;
-    vector<vector<int>> tiles(numberOfTiles);
-    recAllSetOfTiles(tiles, 0, 0);
+    if (SYMMETRY_OPTIMIZATION == 2) {
+        genSymmetries();
+    }
+    if (PARALLEL_OPTIMIZATION == 2) {
+        parallelAllSetOfTiles();
+    } else {
+        vector<vector<int>> tiles(numberOfTiles);
+        auto worker = make_unique<Worker>();
+        recAllSetOfTiles(tiles, 0, 0, *worker, 0);
+        results.merge(worker->statistics);
+    }
     cout << "recAllSetOfTiles: ok" << endl;
     cout << endl;
 }
@@ -348,6 +915,9 @@ void generate() {
 // Вывод статистики
 void outputResults() {
     cout << "number of checked sets = " << numberOfAllSets << endl;
+    if (SYMMETRY_OPTIMIZATION == 2) {
+        cout << "number of solved sets (one per symmetry class) = " << numberOfSolvedSets << endl;
+    }
     cout << "number of tiling sets = " << numberOfAllTilingSets << endl;
     cout << "number of non tiling sets = " << numberOfAllNonTilingSets << endl;
     cout << endl;
@@ -355,10 +925,10 @@ void outputResults() {
     cout << "statistics on the number of tiling sets for a given minimum period" << endl;
     for (int h = 1; h < N; ++h) {
         for (int w = 1; w < N; ++w) {
-            if (numberOfTilingSets[h][w] == 0) {
+            if (results.numberOfTilingSets[h][w] == 0) {
                 continue;
             } else {
-                cout << "h = " << h << " w = " << w << " number of tiling sets = " << numberOfTilingSets[h][w] << endl;
+                cout << "h = " << h << " w = " << w << " number of tiling sets = " << results.numberOfTilingSets[h][w] << endl;
             }
         }
     }
@@ -367,10 +937,10 @@ void outputResults() {
     cout << "statistics on the number of non tiling sets for a given maximum tiled rectangle" << endl;
     for (int h = 1; h < N; ++h) {
         for (int w = 1; w < N; ++w) {
-            if (numberOfNonTilingSets[h][w] == 0) {
+            if (results.numberOfNonTilingSets[h][w] == 0) {
                 continue;
             } else {
-                cout << "h = " << h << " w = " << w << " number of non tiling sets = " << numberOfNonTilingSets[h][w] << endl;
+                cout << "h = " << h << " w = " << w << " number of non tiling sets = " << results.numberOfNonTilingSets[h][w] << endl;
             }
         }
     }
@@ -390,11 +960,11 @@ void answerForQueries() {
             cout << "input size of minimum tiling rectangle: (height width)" << endl;
             int h, w;
             cin >> h >> w;
-            if (numberOfTilingSets[h][w] == 0) {
+            if (results.numberOfTilingSets[h][w] == 0) {
                 cout << "fail: there aren't relevant sets for your's query" << endl;
             } else {
                 cout << "sample set" << endl;
-                for (auto tile : sampleTilingSet[h][w]) {
+                for (auto tile : results.sampleTilingSet[h][w]) {
                     for (auto side : tile) {
                         cout << side << " ";
                     }
@@ -403,7 +973,7 @@ void answerForQueries() {
                 cout << "minimum period for sample set" << endl;
                 for (int x = 0; x < h; ++x) {
                     for (int y = 0; y < w; ++y) {
-                        cout << static_cast<char>('A' + sampleTilingRectangle[h][w][x][y]);
+                        cout << static_cast<char>('A' + results.sampleTilingRectangle[h][w][x][y]);
                     }
                     cout << endl;
                 }
@@ -412,11 +982,11 @@ void answerForQueries() {
             cout << "input size of maximum tiled rectangle: (height width)" << endl;
             int h, w;
             cin >> h >> w;
-            if (numberOfNonTilingSets[h][w] == 0) {
+            if (results.numberOfNonTilingSets[h][w] == 0) {
                 cout << "fail: there aren't relevant sets for your's query" << endl;
             } else {
                 cout << "sample set" << endl;
-                for (auto tile : sampleNonTilingSet[h][w]) {
+                for (auto tile : results.sampleNonTilingSet[h][w]) {
                     for (auto side : tile) {
                         cout << side << " ";
                     }
@@ -425,7 +995,7 @@ void answerForQueries() {
                 cout << "maximum tiled rectangle for sample set" << endl;
                 for (int x = 0; x < h; ++x) {
                     for (int y = 0; y < w; ++y) {
-                        cout << static_cast<char>('A' + sampleNonTilingRectangle[h][w][x][y]);
+                        cout << static_cast<char>('A' + results.sampleNonTilingRectangle[h][w][x][y]);
                     }
                     cout << endl;
                 }
@@ -1,266 +1,913 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <iostream>
-#include <set>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 using namespace std;
 
 namespace Solver{
-    int numberOfTiles; // количество тайлов
-    int maximumSize; // максимальный размер квадрата, который проверяем
-    vector<vector<int>> tiles; // заданный набор тайлов 
-
     // Перебор направлений
     // x - столбцы, y - строки
     // противоположный - ^ 2
     const vector<int> dx = {-1, 0, 1, 0}; // up, right, down, left
     const vector<int> dy = {0, 1, 0, -1};  
 
-    bool isSame(int type1, int type2, int dir1) {
-        return tiles[type1][dir1] == tiles[type2][dir1 ^ 2];
-    }
+    // Клетка прямоугольника, пустая клетка - EMPTY_CELL
+    // Если вдруг numberOfTiles будет >= 255 - нужно поставить Cell = uint16_t
+    typedef uint8_t Cell;
+    const Cell EMPTY_CELL = numeric_limits<Cell>::max();
 
-    // Проверка замощённого прямоугольника - является ли он периодом
-    bool isTilingRectangle(const vector<vector<int>>& table) {
-        assert(!table.empty());
-        int n = table.size();
-        assert(!table[0].empty());
-        int m = table[0].size();
+    // Прямоугольник внутри плоского буфера: n строк по m клеток подряд
+    struct TableView {
+        const Cell* cells;
+        int n;
+        int m;
 
-        for (int x = 0; x < n; ++x) {
-            // table[x][0][3] != table[x][m - 1][1]
-            if (!isSame(table[x][0], table[x][m - 1], 3)) {
-                return false;
-            }
+        Cell get(int x, int y) const {
+            return cells[x * m + y];
         }
+    };
 
-        for (int y = 0; y < m; ++y) {
-            // table[0][y][0] != table[n - 1][y][2]
-            if (!isSame(table[0][y], table[n - 1][y], 0)) {
-                return false;
+    vector<vector<int>> toMatrix(const TableView& table) {
+        vector<vector<int>> matrix(table.n, vector<int>(table.m));
+        for (int x = 0; x < table.n; ++x) {
+            for (int y = 0; y < table.m; ++y) {
+                matrix[x][y] = table.get(x, y);
             }
         }
-
-        return true;
+        return matrix;
     }
 
-    // Проверка для точки на принадлежность bounding box
-    bool isInTable(const vector<vector<int>>& table, int x, int y) {
-        if (table.empty() || table[0].empty()) {
-            return false;
+    // Минимальный циклический период последовательности из n элементов, same(i, j) - равны ли i-й и j-й элементы
+    // Считается префикс-функцией за O(n) сравнений; если n - pi[n - 1] не делит n, последовательность циклически примитивна
+    int getMinimalPeriod(int n, const function<bool(int, int)>& same) {
+        vector<int> pi(n, 0);
+        for (int i = 1; i < n; ++i) {
+            int k = pi[i - 1];
+            while (k > 0 && !same(i, k)) {
+                k = pi[k - 1];
+            }
+            if (same(i, k)) {
+                ++k;
+            }
+            pi[i] = k;
         }
-
-        return x >= 0 && x < (int)table.size() && y >= 0 && y < (int)table[0].size();
+        int period = n - pi[n - 1];
+        return n % period == 0 ? period : n;
     }
 
-    // Проверка для тайла можно ли его поставить в данную точку
-    bool canPutTile(const vector<vector<int>>& table, int x, int y, int type) {
-        //cout << "x = " << x << " y = " << y << endl;
-        assert(isInTable(table, x, y));
-
-        for (int dir = 0; dir < 4; ++dir) {
-            int nx = x + dx[dir];
-            int ny = y + dy[dir];
-            if (!isInTable(table, nx, ny)) continue;
-            if (table[nx][ny] == -1) continue;
-            if (!isSame(type, table[nx][ny], dir)) {
+    // Примитивный период тора h * w и его фундаментальная область
+    // table[x][y] == table[x % dx][y % dy] <=> последовательность строк dx-периодична и последовательность столбцов dy-периодична,
+    // поэтому минимальные dx и dy ищутся независимо: префикс-функция по строкам и по столбцам
+    // Строки и столбцы сравниваются сначала по хешу, при совпадении - поклеточно, всего O(h * w)
+    vector<vector<int>> getPrimitivePeriod(const TableView& table) {
+        int h = table.n;
+        int w = table.m;
+        const uint64_t BASE = 1000003;
+        vector<uint64_t> rowHash(h, 0);
+        vector<uint64_t> columnHash(w, 0);
+        for (int x = 0; x < h; ++x) {
+            for (int y = 0; y < w; ++y) {
+                rowHash[x] = rowHash[x] * BASE + table.get(x, y) + 1;
+                columnHash[y] = columnHash[y] * BASE + table.get(x, y) + 1;
+            }
+        }
+        int dx = getMinimalPeriod(h, [&](int i, int j) {
+            if (rowHash[i] != rowHash[j]) {
+                return false;
+            }
+            for (int y = 0; y < w; ++y) {
+                if (table.get(i, y) != table.get(j, y)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        int dy = getMinimalPeriod(w, [&](int i, int j) {
+            if (columnHash[i] != columnHash[j]) {
                 return false;
             }
+            for (int x = 0; x < h; ++x) {
+                if (table.get(x, i) != table.get(x, j)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        vector<vector<int>> domain(dx, vector<int>(dy));
+        for (int x = 0; x < dx; ++x) {
+            for (int y = 0; y < dy; ++y) {
+                domain[x][y] = table.get(x, y);
+            }
         }
-
-        return true;
+        return domain;
     }
 
-    vector<int> getD(int x) {
-        vector<int> ans;
-        for (int i = 1; i * i <= x; ++i) {
-            if (x % i) continue;
-            ans.push_back(i);
-            if (x == i * i) continue;
-            ans.push_back(x / i);
+    // Начало минимального циклического сдвига последовательности из n элементов, compare(i, j) - знак сравнения i-го и j-го
+    // Метод двух указателей, O(n) сравнений
+    int getMinimalRotation(int n, const function<int(int, int)>& compare) {
+        int i = 0;
+        int j = 1;
+        int k = 0;
+        while (i < n && j < n && k < n) {
+            int sign = compare((i + k) % n, (j + k) % n);
+            if (sign == 0) {
+                ++k;
+                continue;
+            }
+            if (sign > 0) {
+                i += k + 1;
+            } else {
+                j += k + 1;
+            }
+            if (i == j) {
+                ++j;
+            }
+            k = 0;
         }
-        sort(ans.begin(), ans.end());
-        return ans;
+        return min(i, j);
     }
 
-    bool checkSubPeriod(const vector<vector<int>>& table) {
+    // Канонический представитель тора с точностью до циклических сдвигов
+    // Для каждого сдвига строк r сдвиг столбцов - минимальный циклический сдвиг последовательности столбцов,
+    // из h кандидатов берётся лексикографически меньший, всего O(h * h * w)
+    vector<vector<int>> getCanonicalShift(const vector<vector<int>>& table) {
         int h = table.size();
         int w = table[0].size();
-        auto dh = getD(h);
-        auto dw = getD(w);
-        /*for (auto x : dh) cerr << x << " ";
-        cout << endl;
-        for (auto y : dw) cerr << y << " ";
-        cout << endl;*/
-        for (auto dx : dh) {
-            for (auto dy : dw) {
-                if (dx == h && dy == w) continue;
-                bool ok = true;
+        vector<vector<int>> best;
+        vector<vector<int>> current(h, vector<int>(w));
+        for (int r = 0; r < h; ++r) {
+            int s = getMinimalRotation(w, [&](int i, int j) {
                 for (int x = 0; x < h; ++x) {
-                    for (int y = 0; y < w; ++y) {
-                        if (table[x][y] != table[x % dx][y % dy]) {
-                            //cerr << "puhh2" << endl;
-                            ok = false;
-                            break;
-                        }
-                    }
-                    if (!ok) {
-                        break;
+                    int a = table[(x + r) % h][i];
+                    int b = table[(x + r) % h][j];
+                    if (a != b) {
+                        return a < b ? -1 : 1;
                     }
                 }
-                if (ok) {
-                    /*cerr << "table = " << endl;
-                    for (auto i : table) {
-                        for (auto j : i) {
-                            cout << j << " ";
-                        }
-                        cout << endl;
-                    }
-                    cerr << "dx = " << dx << " dy = " << dy << endl;*/
-                    //exit(0);
-                    return true;
+                return 0;
+            });
+            for (int x = 0; x < h; ++x) {
+                for (int y = 0; y < w; ++y) {
+                    current[x][y] = table[(x + r) % h][(y + s) % w];
                 }
             }
+            if (best.empty() || current < best) {
+                best = current;
+            }
         }
-        return false;
+        return best;
     }
 
-    // конструкции вида: vector<vector<vector<vector<vector<int>>>>> - это смерть, 3 - тоже плохо, но не совсем смерть
-    // Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
-    const int N = 123;
-    vector<vector<vector<int>>> allTables[N][N];
-    vector<vector<int>> minimumTilingRectangle;
-    vector<vector<int>> maximumTiledRectangle;
-    bool foundPeriod;
-
-    set<pair<int, int>> used;
-
-    // Обновить ответы замощённым прямоугольником
-    void relaxAnswers(const vector<vector<int>>& table) {
-        if (isTilingRectangle(table)) {
-            minimumTilingRectangle = table;
-            int h = table.size();
-            int w = table[0].size();
-            if (!used.count({w, h}) && !checkSubPeriod(table)) {
-                cout << "period for sample set: h = " << h << " w = " << w << endl;
-                for (int x = 0; x < h; ++x) {
-                    for (int y = 0; y < w; ++y) {
-                        cout << static_cast<char>('A' + table[x][y]);
+    // Симметрия набора тайлов: транспонирование, затем отражение строк и столбцов,
+    // tileMap - в какой тайл набора переходит каждый тайл
+    struct TileSymmetry {
+        bool transpose;
+        bool flipRows;
+        bool flipColumns;
+        vector<int> tileMap;
+    };
+
+    // Все преобразования квадрата, переводящие набор тайлов в себя (тождественное - первое)
+    vector<TileSymmetry> getTileSymmetries(const vector<vector<int>>& tiles) {
+        vector<TileSymmetry> symmetries;
+        for (int mask = 0; mask < 8; ++mask) {
+            TileSymmetry symmetry = {static_cast<bool>(mask & 4), static_cast<bool>(mask & 2), static_cast<bool>(mask & 1), {}};
+            for (const auto& tile : tiles) {
+                auto side = tile;
+                if (symmetry.transpose) {
+                    side = {tile[3], tile[2], tile[1], tile[0]};
+                }
+                if (symmetry.flipRows) {
+                    swap(side[0], side[2]);
+                }
+                if (symmetry.flipColumns) {
+                    swap(side[1], side[3]);
+                }
+                // k-я копия тайла переходит в k-ю копию образа, иначе одинаковые тайлы склеятся
+                int copy = count(tiles.begin(), tiles.begin() + symmetry.tileMap.size(), tile);
+                int image = -1;
+                for (int i = 0; i < static_cast<int>(tiles.size()) && copy >= 0; ++i) {
+                    if (tiles[i] == side && copy-- == 0) {
+                        image = i;
                     }
-                    cout << endl;
                 }
-                used.insert({w, h});
+                if (image == -1) {
+                    break;
+                }
+                symmetry.tileMap.push_back(image);
+            }
+            if (symmetry.tileMap.size() == tiles.size()) {
+                symmetries.push_back(symmetry);
             }
-            //foundPeriod = true;
         }
-        allTables[table.size()][table[0].size()].push_back(table);
+        return symmetries;
     }
 
-    // Рекурсивная штука пытается заполнить полоску от таблички (из -1)
-    //  0  1 -1
-    //  1  2 -1
-    // -1 -1 -1
-    void recTryToAdd(vector<vector<int>>& table, int x, int y) {
-        if (x == -1) {
-            relaxAnswers(table);
-        } else {
-            assert(!table.empty());
-            assert(!table[0].empty());
-            int m = table[0].size();
-
-            int nx = x, ny = y;
-            if (ny + 1 < m) {
-                ++ny;
-            } else {
-                --nx;
-            }
-
-            for (int type = 0; type < numberOfTiles; ++type) {
-                if (!canPutTile(table, x, y, type)) continue;
-                
-                table[x][y] = type;
-                recTryToAdd(table, nx, ny);
-                table[x][y] = -1;
+    vector<vector<int>> applySymmetry(const vector<vector<int>>& table, const TileSymmetry& symmetry) {
+        int h = table.size();
+        int w = table[0].size();
+        if (symmetry.transpose) {
+            swap(h, w);
+        }
+        vector<vector<int>> result(h, vector<int>(w));
+        for (int x = 0; x < h; ++x) {
+            for (int y = 0; y < w; ++y) {
+                int fromX = symmetry.flipRows ? h - 1 - x : x;
+                int fromY = symmetry.flipColumns ? w - 1 - y : y;
+                if (symmetry.transpose) {
+                    swap(fromX, fromY);
+                }
+                result[x][y] = symmetry.tileMap[table[fromX][fromY]];
             }
         }
-    }    
+        return result;
+    }
 
-    // Расширяет прямоугольник в нужную сторону и запускает рекурсию
-    void tryToAdd(const vector<vector<int>>& baseTable, int n, int m) {
-        auto table = baseTable;
-        for (int x = 0; x < n; ++x) {
-            if (table.size() == x) {
-                table.push_back(vector<int>(m, -1));
+    // Канонический представитель тора с точностью до сдвигов и данных симметрий;
+    // транспонирование меняет размер, поэтому применяется только к квадратам
+    vector<vector<int>> getCanonicalPeriod(const vector<vector<int>>& table, const vector<TileSymmetry>& symmetries) {
+        bool isSquare = table.size() == table[0].size();
+        vector<vector<int>> best;
+        for (const auto& symmetry : symmetries) {
+            if (symmetry.transpose && !isSquare) {
+                continue;
             }
-            while (table[x].size() < m) {
-                table[x].push_back(-1);
+            auto current = getCanonicalShift(applySymmetry(table, symmetry));
+            if (best.empty() || current < best) {
+                best = current;
             }
         }
-
-        recTryToAdd(table, n - 1, 0);
+        return best;
     }
 
+    // Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
+    const int N = 123;
+
     // Перебирать или не перебирать периоды x * 1 (1 - да, 2 - нет)
     const int FIRST_SQUARE_OPTIMIZATION = 1;
 
     // Перебирать или не перебирать периоды n * m, n < m (1 - да, 2 - нет)
     const int LEXICOGRAPHIC_OPTIMIZATION = 1;
 
-    // main
-    void run() {
-        for (int h = 0; h <= maximumSize; ++h) {
-            for (int w = 0; w <= maximumSize; ++w) {
-                allTables[h][w].clear();
-                if (h == 0 || w == 0) {
-                    allTables[h][w].push_back(vector<vector<int>>());
+    // Перед заполнением полоски сужать домены её клеток до тайлов, с которых полоска дозаполняется (1 - нет, 2 - да)
+    const int FORWARD_CHECKING_OPTIMIZATION = 2;
+
+    // Освобождать allTables[h - 1][w - 1], как только построен allTables[h][w] (1 - нет, 2 - да)
+    // Живут только две соседние строки корзин, а лучший незамощаемый прямоугольник запоминается сразу
+    const int ROLLING_FRONTIER_OPTIMIZATION = 2;
+
+    // Хранить прямоугольники с одинаковой границей один раз (1 - нет, 2 - да)
+    // Продолжение прямоугольника зависит только от последней строки и столбца, проверка периода -
+    // от первых и последних, так что из прямоугольников с одинаковой границей остаётся первый
+    // Здесь выключено: у отброшенного прямоугольника может быть примитивный период, а у представителя - нет
+    const int BOUNDARY_OPTIMIZATION = 1;
+
+    // Что выводить о периодах (1 - первый примитивный период каждого размера,
+    // 2 - число различных примитивных периодов каждого размера с точностью до сдвигов тора,
+    // 3 - то же с точностью до сдвигов и симметрий набора тайлов)
+    const int PERIOD_CANONICAL_FORM = 1;
+
+    // Искать периоды каждого размера h * w отдельной задачей на торе в пуле потоков (1 - нет, 2 - да)
+    // Задачи идут от дешёвых к дорогим, итоги печатаются в том же порядке, максимальный незамощённый прямоугольник не ищется
+    const int PARALLEL_SIZES_OPTIMIZATION = 1;
+
+    // Всё состояние одного решателя. Контекст переиспользуется между вызовами solve():
+    // буферы сохраняют ёмкость, а чистится только та часть allTables, которую занял прошлый запуск.
+    // Контексты независимы, поэтому несколько штук могут работать одновременно в разных потоках.
+    // Внутри лежит allTables[N][N], так что контекст лучше создавать в куче или статически
+    class SolverContext {
+    public:
+        // Эта часть для внешнего доступа, запускает Solver на заданном наборе тайлов и выдаёт требуемые ответы
+        void solve(
+            const int _numberOfTiles,
+            const int _maximumSize,
+            const vector<vector<int>>& _tiles,
+            bool& _foundPeriod,
+            vector<vector<int>>& _minimumTilingRectangle,
+            vector<vector<int>>& _maximumTiledRectangle
+            ) {
+            numberOfTiles = _numberOfTiles;
+            maximumSize = _maximumSize;
+            tiles = _tiles;
+            assert(numberOfTiles < EMPTY_CELL);
+            buildCompatibleMasks();
+            run();
+            _foundPeriod = foundPeriod;
+            _minimumTilingRectangle = minimumTilingRectangle;
+            _maximumTiledRectangle = maximumTiledRectangle;
+        }
+
+        // Ленивый перебор замощённых прямоугольников в том же порядке, что и в run() (по возрастанию размера).
+        // startRectangles() готовит перебор, nextRectangle() выдаёт следующий прямоугольник и то, период ли он,
+        // false - прямоугольники до maximumSize кончились. Состояние перебора лежит в контексте (явный стек
+        // по клеткам полоски), так что перебор можно бросить в любой момент или продолжить позже.
+        // table указывает внутрь allTables и живёт до следующего вызова
+        void startRectangles(const int _numberOfTiles, const int _maximumSize, const vector<vector<int>>& _tiles) {
+            numberOfTiles = _numberOfTiles;
+            maximumSize = _maximumSize;
+            tiles = _tiles;
+            assert(numberOfTiles < EMPTY_CELL);
+            buildCompatibleMasks();
+            startGenerator();
+        }
+
+        bool nextRectangle(TableView& table, bool& isPeriod) {
+            while (generatorH <= maximumSize) {
+                if (generatorDepth == -1) {
+                    nextStrip();
+                    continue;
+                }
+                TableView strip = {currentTable.data(), generatorH, generatorW};
+                int length = generatorH + generatorW - 1;
+                if (generatorDepth == length) {
+                    --generatorDepth;
+                    if (addRectangle(strip, isPeriod)) {
+                        table = getTable(generatorH, generatorW, countTables(generatorH, generatorW) - 1);
+                        return true;
+                    }
+                    continue;
+                }
+
+                int x, y;
+                getStripCell(strip, generatorDepth, x, y);
+                currentTable[x * generatorW + y] = EMPTY_CELL;
+                unsigned long long* candidates = &stripCandidates[generatorDepth * maskWords];
+                int word = 0;
+                while (word < maskWords && candidates[word] == 0) {
+                    ++word;
+                }
+                if (word == maskWords) {
+                    --generatorDepth; // варианты клетки кончились, возвращаемся к предыдущей
+                    continue;
+                }
+                currentTable[x * generatorW + y] = word * 64 + __builtin_ctzll(candidates[word]);
+                candidates[word] &= candidates[word] - 1;
+                ++generatorDepth;
+                if (generatorDepth < length) {
+                    loadStripCandidates(strip, generatorDepth);
+                }
+            }
+            return false;
+        }
+
+        // Перебирает все замощения тора h * w и для каждого вызывает onTorus, пока тот не вернёт false.
+        // Не зависит от startRectangles(), так что в пуле потоков каждому потоку хватает своего контекста
+        void enumerateTorus(
+            const int _numberOfTiles,
+            const vector<vector<int>>& _tiles,
+            int h,
+            int w,
+            const function<bool(const TableView&)>& onTorus
+            ) {
+            numberOfTiles = _numberOfTiles;
+            tiles = _tiles;
+            assert(numberOfTiles < EMPTY_CELL);
+            buildCompatibleMasks();
+            torus.assign(h * w, EMPTY_CELL);
+            recTorus(h, w, 0, onTorus);
+        }
+
+        // Имеет смысл после того, как nextRectangle() вернул false
+        vector<vector<int>> getMaximumTiledRectangle() {
+            return maximumTiledRectangle;
+        }
+
+    private:
+        int numberOfTiles; // количество тайлов
+        int maximumSize; // максимальный размер квадрата, который проверяем
+        vector<vector<int>> tiles; // заданный набор тайлов 
+
+        bool isSame(int type1, int type2, int dir1) {
+            return tiles[type1][dir1] == tiles[type2][dir1 ^ 2];
+        }
+
+        // Проверка замощённого прямоугольника - является ли он периодом
+        bool isTilingRectangle(const TableView& table) {
+            assert(table.n > 0);
+            int n = table.n;
+            assert(table.m > 0);
+            int m = table.m;
+
+            for (int x = 0; x < n; ++x) {
+                // table[x][0][3] != table[x][m - 1][1]
+                if (!isSame(table.get(x, 0), table.get(x, m - 1), 3)) {
+                    return false;
+                }
+            }
+
+            for (int y = 0; y < m; ++y) {
+                // table[0][y][0] != table[n - 1][y][2]
+                if (!isSame(table.get(0, y), table.get(n - 1, y), 0)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Проверка для точки на принадлежность bounding box
+        bool isInTable(const TableView& table, int x, int y) {
+            return x >= 0 && x < table.n && y >= 0 && y < table.m;
+        }
+
+        // Маски совместимости, строятся один раз на solve()
+        // бит type в слове compatibleMask[dir][other * maskWords + type / 64] стоит, если тайл type
+        // можно поставить так, чтобы тайл other оказался его соседом в направлении dir
+        int maskWords;
+        vector<unsigned long long> compatibleMask[4];
+
+        void buildCompatibleMasks() {
+            maskWords = (numberOfTiles + 63) / 64;
+            for (int dir = 0; dir < 4; ++dir) {
+                compatibleMask[dir].assign(numberOfTiles * maskWords, 0);
+                for (int other = 0; other < numberOfTiles; ++other) {
+                    for (int type = 0; type < numberOfTiles; ++type) {
+                        if (isSame(type, other, dir)) {
+                            compatibleMask[dir][other * maskWords + type / 64] |= 1ULL << (type % 64);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Маска тайлов из слова word, которые можно поставить в данную точку
+        unsigned long long getCandidates(const TableView& table, int x, int y, int word) {
+            assert(isInTable(table, x, y));
+
+            unsigned long long candidates = ~0ULL;
+            if (word == maskWords - 1 && numberOfTiles % 64 != 0) {
+                candidates = (1ULL << (numberOfTiles % 64)) - 1;
+            }
+
+            for (int dir = 0; dir < 4 && candidates; ++dir) {
+                int nx = x + dx[dir];
+                int ny = y + dy[dir];
+                if (!isInTable(table, nx, ny)) continue;
+                if (table.get(nx, ny) == EMPTY_CELL) continue;
+                candidates &= compatibleMask[dir][table.get(nx, ny) * maskWords + word];
+            }
+
+            return candidates;
+        }
+
+        // конструкции вида: vector<vector<vector<vector<vector<int>>>>> - это смерть, 3 - тоже плохо, но не совсем смерть
+        // поэтому все прямоугольники h * w лежат подряд в одном буфере allTables[h][w]
+        vector<Cell> allTables[N][N];
+        vector<Cell> currentTable; // прямоугольник, полоску которого сейчас заполняет nextRectangle
+        vector<vector<int>> minimumTilingRectangle;
+        vector<vector<int>> maximumTiledRectangle;
+        bool foundPeriod;
+        int usedSize = 0; // до какого размера заняты allTables с прошлого запуска
+        int lastH, lastW, lastIndex; // последний незамощаемый прямоугольник с w <= h, -1 - его нет или он уже скопирован
+        // Открытая адресация по хешу границы: номера прямоугольников заполняемого allTables[h][w], -1 - пусто
+        vector<int> boundaryTable;
+        int numberOfBoundaries = 0;
+
+        // Хеш первой и последней строк, первого и последнего столбцов
+        unsigned long long getBoundaryHash(const TableView& table) {
+            unsigned long long hash = 14695981039346656037ULL;
+            for (int y = 0; y < table.m; ++y) {
+                hash = (hash ^ table.get(0, y)) * 1099511628211ULL;
+                hash = (hash ^ table.get(table.n - 1, y)) * 1099511628211ULL;
+            }
+            for (int x = 0; x < table.n; ++x) {
+                hash = (hash ^ table.get(x, 0)) * 1099511628211ULL;
+                hash = (hash ^ table.get(x, table.m - 1)) * 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        bool isSameBoundary(const TableView& table1, const TableView& table2) {
+            for (int y = 0; y < table1.m; ++y) {
+                if (table1.get(0, y) != table2.get(0, y) || table1.get(table1.n - 1, y) != table2.get(table2.n - 1, y)) {
+                    return false;
+                }
+            }
+            for (int x = 0; x < table1.n; ++x) {
+                if (table1.get(x, 0) != table2.get(x, 0) || table1.get(x, table1.m - 1) != table2.get(x, table2.m - 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void clearBoundaries() {
+            boundaryTable.assign(16, -1);
+            numberOfBoundaries = 0;
+        }
+
+        void insertBoundary(int h, int w, int index) {
+            size_t mask = boundaryTable.size() - 1;
+            size_t cell = getBoundaryHash(getTable(h, w, index)) & mask;
+            while (boundaryTable[cell] != -1) {
+                cell = (cell + 1) & mask;
+            }
+            boundaryTable[cell] = index;
+        }
+
+        // Есть ли в allTables[table.n][table.m] прямоугольник с такой же границей, если нет - запоминает,
+        // что table будет лежать там под номером countTables(table.n, table.m)
+        bool isKnownBoundary(const TableView& table) {
+            int h = table.n, w = table.m;
+            if (h < 3 || w < 3) {
+                return false; // внутренности нет, граница - весь прямоугольник
+            }
+            if (2 * (numberOfBoundaries + 1) > (int)boundaryTable.size()) {
+                boundaryTable.assign(2 * boundaryTable.size(), -1);
+                for (int index = 0; index < numberOfBoundaries; ++index) {
+                    insertBoundary(h, w, index);
+                }
+            }
+            size_t mask = boundaryTable.size() - 1;
+            size_t cell = getBoundaryHash(table) & mask;
+            while (boundaryTable[cell] != -1) {
+                if (isSameBoundary(getTable(h, w, boundaryTable[cell]), table)) {
+                    return true;
+                }
+                cell = (cell + 1) & mask;
+            }
+            boundaryTable[cell] = numberOfBoundaries++;
+            return false;
+        }
+
+        // Количество прямоугольников h * w (прямоугольник с нулевой стороной ровно один - пустой)
+        int countTables(int h, int w) {
+            if (h == 0 || w == 0) {
+                return 1;
+            }
+            return allTables[h][w].size() / (h * w);
+        }
+
+        TableView getTable(int h, int w, int index) {
+            return {allTables[h][w].data() + (size_t)index * h * w, h, w};
+        }
+
+        // Освободить память allTables[h][w], перед этим скопировав из него последний незамощаемый прямоугольник
+        void freeTables(int h, int w) {
+            if (lastIndex != -1 && lastH == h && lastW == w) {
+                maximumTiledRectangle = toMatrix(getTable(h, w, lastIndex));
+                lastIndex = -1;
+            }
+            vector<Cell>().swap(allTables[h][w]);
+        }
+
+        // Добавить замощённый прямоугольник в allTables, false - такой (с той же границей) там уже есть
+        bool addRectangle(const TableView& table, bool& isPeriod) {
+            if (BOUNDARY_OPTIMIZATION == 2 && isKnownBoundary(table)) {
+                return false;
+            }
+            isPeriod = isTilingRectangle(table);
+            if (!isPeriod && ROLLING_FRONTIER_OPTIMIZATION == 2 && table.m <= table.n) {
+                lastH = table.n, lastW = table.m, lastIndex = countTables(table.n, table.m);
+            }
+            auto& bucket = allTables[table.n][table.m];
+            bucket.insert(bucket.end(), table.cells, table.cells + table.n * table.m);
+            return true;
+        }
+
+        // Домены клеток полоски: stripDomains[i * maskWords + word] - тайлы из слова word,
+        // которые можно поставить в i-ю по порядку заполнения клетку так, чтобы полоска дозаполнилась
+        vector<unsigned long long> stripDomains;
+
+        // Порядок заполнения полоски: нижняя строка слева направо, потом правый столбец снизу вверх
+        void getStripCell(const TableView& table, int i, int& x, int& y) {
+            x = i < table.m ? table.n - 1 : table.n - 1 - (i - (table.m - 1));
+            y = i < table.m ? i : table.m - 1;
+        }
+
+        // В полоске каждая клетка соседствует только с предыдущей и следующей, поэтому одного прохода
+        // с конца хватает, чтобы в доменах остались ровно дозаполняемые тайлы: перебор не заходит в тупики,
+        // а клетки с одним вариантом проходятся без ветвления. false - полоску заполнить нельзя
+        bool buildStripDomains(const TableView& table) {
+            int length = table.n + table.m - 1;
+            stripDomains.assign(length * maskWords, 0);
+            for (int i = length - 1; i >= 0; --i) {
+                int x, y;
+                getStripCell(table, i, x, y);
+                unsigned long long* domain = &stripDomains[i * maskWords];
+                if (i + 1 < length) {
+                    int dir = i + 1 < table.m ? 1 : 0; // следующая клетка справа или сверху
+                    const unsigned long long* nextDomain = &stripDomains[(i + 1) * maskWords];
+                    for (int word = 0; word < maskWords; ++word) {
+                        unsigned long long next = nextDomain[word];
+                        while (next) {
+                            int type = word * 64 + __builtin_ctzll(next);
+                            next &= next - 1;
+                            for (int to = 0; to < maskWords; ++to) {
+                                domain[to] |= compatibleMask[dir][type * maskWords + to];
+                            }
+                        }
+                    }
+                } else {
+                    for (int word = 0; word < maskWords; ++word) {
+                        domain[word] = ~0ULL;
+                    }
+                }
+                bool isEmpty = true;
+                for (int word = 0; word < maskWords; ++word) {
+                    domain[word] &= getCandidates(table, x, y, word);
+                    isEmpty &= domain[word] == 0;
+                }
+                if (isEmpty) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Состояние ленивого перебора: строится allTables[generatorH][generatorW] расширением основы номер
+        // generatorIndex из allTables[generatorH - 1][generatorW - 1], в полоске заполнено generatorDepth клеток
+        // (-1 - полоска не начата), stripCandidates[i * maskWords + word] - ещё не опробованные тайлы i-й клетки
+        int generatorH, generatorW;
+        int generatorIndex;
+        int generatorDepth;
+        vector<unsigned long long> stripCandidates;
+
+        void startGenerator() {
+            for (int h = 0; h <= usedSize; ++h) {
+                for (int w = 0; w <= usedSize; ++w) {
+                    allTables[h][w].clear();
+                }
+            } 
+            usedSize = maximumSize;
+
+            foundPeriod = false;
+            maximumTiledRectangle.clear();
+            lastIndex = -1;
+
+            generatorH = 1;
+            generatorW = min(1, FIRST_SQUARE_OPTIMIZATION);
+            generatorIndex = -1;
+            generatorDepth = -1;
+            clearBoundaries();
+        }
+
+        vector<Cell> torus; // тор h * w, который заполняет recTorus
+
+        unsigned long long getAllTilesMask(int word) {
+            if (word == maskWords - 1 && numberOfTiles % 64 != 0) {
+                return (1ULL << (numberOfTiles % 64)) - 1;
+            }
+            return ~0ULL;
+        }
+
+        // Маска тайлов из слова word, которые можно поставить в клетку тора (соседи через край тоже соседи)
+        unsigned long long getTorusCandidates(int h, int w, int x, int y, int word) {
+            unsigned long long candidates = getAllTilesMask(word);
+            for (int dir = 0; dir < 4 && candidates; ++dir) {
+                int nx = (x + dx[dir] + h) % h;
+                int ny = (y + dy[dir] + w) % w;
+                if (nx == x && ny == y) {
+                    // при h == 1 или w == 1 клетка соседствует сама с собой
+                    for (unsigned long long rest = candidates; rest; rest &= rest - 1) {
+                        int type = word * 64 + __builtin_ctzll(rest);
+                        if (!isSame(type, type, dir)) {
+                            candidates &= ~(1ULL << (type % 64));
+                        }
+                    }
+                } else if (torus[nx * w + ny] != EMPTY_CELL) {
+                    candidates &= compatibleMask[dir][torus[nx * w + ny] * maskWords + word];
+                }
+            }
+            return candidates;
+        }
+
+        // Заполняет тор, каждый раз выбирая пустую клетку с наименьшим числом вариантов,
+        // false - onTorus попросил остановиться
+        bool recTorus(int h, int w, int filled, const function<bool(const TableView&)>& onTorus) {
+            if (filled == h * w) {
+                return onTorus({torus.data(), h, w});
+            }
+            int bestCell = -1, bestCount = numberOfTiles + 1;
+            for (int cell = 0; cell < h * w && bestCount > 1; ++cell) {
+                if (torus[cell] != EMPTY_CELL) {
+                    continue;
+                }
+                int count = 0;
+                for (int word = 0; word < maskWords; ++word) {
+                    count += __builtin_popcountll(getTorusCandidates(h, w, cell / w, cell % w, word));
+                }
+                if (count == 0) {
+                    return true;
+                }
+                if (count < bestCount) {
+                    bestCell = cell, bestCount = count;
                 }
             }
-        } 
 
-        foundPeriod = false;
+            for (int word = 0; word < maskWords; ++word) {
+                unsigned long long candidates = getTorusCandidates(h, w, bestCell / w, bestCell % w, word);
+                while (candidates) {
+                    int type = word * 64 + __builtin_ctzll(candidates);
+                    candidates &= candidates - 1;
 
-        for (int h = 1; h <= maximumSize && !foundPeriod; ++h) {
-            for (int w = min(h, FIRST_SQUARE_OPTIMIZATION); w <= (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h) && !foundPeriod; ++w) {
-                for (const auto& baseTable : allTables[h - 1][w - 1]) {
-                    if (foundPeriod) {
-                        break;
-                    } else {
-                        tryToAdd(baseTable, h, w);
+                    torus[bestCell] = type;
+                    bool goOn = recTorus(h, w, filled + 1, onTorus);
+                    torus[bestCell] = EMPTY_CELL;
+                    if (!goOn) {
+                        return false;
                     }
                 }
             }
+            return true;
+        }
+
+        // В доменах полоски уже учтены клетки основы, так что с ними остаётся согласовать только предыдущую клетку полоски
+        void loadStripCandidates(const TableView& table, int i) {
+            int x, y;
+            getStripCell(table, i, x, y);
+            for (int word = 0; word < maskWords; ++word) {
+                unsigned long long candidates;
+                if (FORWARD_CHECKING_OPTIMIZATION == 2) {
+                    candidates = stripDomains[i * maskWords + word];
+                    if (i > 0) {
+                        int dir = i < table.m ? 3 : 2; // предыдущая клетка слева или снизу
+                        candidates &= compatibleMask[dir][table.get(x + dx[dir], y + dy[dir]) * maskWords + word];
+                    }
+                } else {
+                    candidates = getCandidates(table, x, y, word);
+                }
+                stripCandidates[i * maskWords + word] = candidates;
+            }
+        }
+
+        // Переход к следующей основе, а когда основы кончились - к следующему размеру
+        void nextStrip() {
+            int h = generatorH, w = generatorW;
+            if (++generatorIndex >= countTables(h - 1, w - 1)) {
+                if (ROLLING_FRONTIER_OPTIMIZATION == 2) {
+                    freeTables(h - 1, w - 1);
+                }
+                generatorIndex = -1;
+                if (++generatorW > (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h)) {
+                    ++generatorH;
+                    generatorW = min(generatorH, FIRST_SQUARE_OPTIMIZATION);
+                }
+                clearBoundaries();
+                if (generatorH > maximumSize) {
+                    finishRectangles();
+                }
+                return;
+            }
+
+            // расширяет прямоугольник в нужную сторону
+            TableView baseTable = getTable(h - 1, w - 1, generatorIndex);
+            currentTable.assign(h * w, EMPTY_CELL);
+            for (int x = 0; x < baseTable.n; ++x) {
+                for (int y = 0; y < baseTable.m; ++y) {
+                    currentTable[x * w + y] = baseTable.get(x, y);
+                }
+            }
+            TableView table = {currentTable.data(), h, w};
+            if (FORWARD_CHECKING_OPTIMIZATION == 2 && !buildStripDomains(table)) {
+                return;
+            }
+            stripCandidates.assign((h + w - 1) * maskWords, 0);
+            generatorDepth = 0;
+            loadStripCandidates(table, 0);
         }
 
-        for (int h = 1; h <= maximumSize; ++h) {
-            for (int w = 1; w <= h; ++w) {
-                for (const auto& table : allTables[h][w]) {
-                    if (!isTilingRectangle(table)) {
-                        maximumTiledRectangle = table;
+        // Все прямоугольники перебраны, остаётся достать maximumTiledRectangle
+        void finishRectangles() {
+            if (ROLLING_FRONTIER_OPTIMIZATION == 1) {
+                lastIndex = -1;
+                for (int h = 1; h <= maximumSize; ++h) {
+                    for (int w = 1; w <= h; ++w) {
+                        for (int index = 0; index < countTables(h, w); ++index) {
+                            if (!isTilingRectangle(getTable(h, w, index))) {
+                                lastIndex = index, lastH = h, lastW = w;
+                            }
+                        }
                     }
                 }
             }
+            if (lastIndex != -1) {
+                maximumTiledRectangle = toMatrix(getTable(lastH, lastW, lastIndex));
+            }
         }
+
+        // main: перебор до первого периода
+        void run() {
+            startGenerator();
+            TableView table;
+            bool isPeriod;
+            while (nextRectangle(table, isPeriod)) {
+                if (isPeriod) {
+                    minimumTilingRectangle = toMatrix(table);
+                    foundPeriod = true;
+                    break;
+                }
+            }
+        }
+    };
+};
+
+// Итог по одному размеру h * w: первый примитивный период (в режимах 2 и 3 - канонический вид первого)
+// и канонические виды всех примитивных периодов
+struct SizeResult {
+    int h = 0;
+    int w = 0;
+    vector<vector<int>> witness;
+    unordered_set<string> canonicalPeriods;
+};
+
+// Учитывает замощение тора h * w; false - периоды этого размера больше не нужны
+bool addPeriod(SizeResult& result, const Solver::TableView& table, const vector<Solver::TileSymmetry>& symmetries) {
+    auto domain = Solver::getPrimitivePeriod(table);
+    if (static_cast<int>(domain.size()) != table.n || static_cast<int>(domain[0].size()) != table.m) {
+        return true;
+    }
+    if (Solver::PERIOD_CANONICAL_FORM == 1) {
+        result.witness = domain;
+        return false;
     }
+    auto canonical = Solver::getCanonicalPeriod(domain, symmetries);
+    string key;
+    for (const auto& row : canonical) {
+        for (auto cell : row) {
+            key.push_back(static_cast<char>(cell));
+        }
+    }
+    result.canonicalPeriods.insert(key);
+    if (result.witness.empty()) {
+        result.witness = canonical;
+    }
+    return true;
+}
 
-    // Эта часть для внешнего доступа, запускает Solver на заданном наборе тайлов и выдаёт требуемые ответы
-    void solve(
-        const int _numberOfTiles,
-        const int _maximumSize,
-        const vector<vector<int>>& _tiles,
-        bool& _foundPeriod,
-        vector<vector<int>>& _minimumTilingRectangle,
-        vector<vector<int>>& _maximumTiledRectangle
-        ) {
-        numberOfTiles = _numberOfTiles;
-        maximumSize = _maximumSize;
-        tiles = _tiles;
-        run();
-        _foundPeriod = foundPeriod;
-        _minimumTilingRectangle = minimumTilingRectangle;
-        _maximumTiledRectangle = maximumTiledRectangle;
+void printSizeResult(const SizeResult& result) {
+    if (result.witness.empty()) {
+        return;
     }
-};
+    if (Solver::PERIOD_CANONICAL_FORM == 1) {
+        cout << "period for sample set: h = " << result.h << " w = " << result.w << endl;
+    } else {
+        cout << "periods for sample set: h = " << result.h << " w = " << result.w << " count = " << result.canonicalPeriods.size() << endl;
+    }
+    for (const auto& row : result.witness) {
+        for (auto cell : row) {
+            cout << static_cast<char>('A' + cell);
+        }
+        cout << endl;
+    }
+}
+
+// Каждый размер h * w - отдельная задача: перебор всех замощений тора.
+// Задачи отсортированы по площади (набор тайлов у всех общий), потоки берут их по очереди,
+// а главный поток печатает итоги в порядке задач, как только готовы все предыдущие
+void censusBySize(int numberOfTiles, int maximumSize, const vector<vector<int>>& tiles, const vector<Solver::TileSymmetry>& symmetries) {
+    vector<SizeResult> jobs;
+    for (int h = 1; h <= maximumSize; ++h) {
+        for (int w = min(h, Solver::FIRST_SQUARE_OPTIMIZATION); w <= (Solver::LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h); ++w) {
+            jobs.push_back({h, w, {}, {}});
+        }
+    }
+    stable_sort(jobs.begin(), jobs.end(), [](const SizeResult& a, const SizeResult& b) {
+        return a.h * a.w < b.h * b.w;
+    });
+
+    atomic<int> nextJob(0);
+    vector<char> done(jobs.size(), 0);
+    mutex doneMutex;
+    condition_variable doneChanged;
+    int numberOfWorkers = max(1u, thread::hardware_concurrency());
+    vector<thread> threads;
+    for (int worker = 0; worker < numberOfWorkers; ++worker) {
+        threads.emplace_back([&]() {
+            auto solver = make_unique<Solver::SolverContext>();
+            for (int job = nextJob++; job < static_cast<int>(jobs.size()); job = nextJob++) {
+                SizeResult& result = jobs[job];
+                solver->enumerateTorus(numberOfTiles, tiles, result.h, result.w, [&](const Solver::TableView& table) {
+                    return addPeriod(result, table, symmetries);
+                });
+                lock_guard<mutex> lock(doneMutex);
+                done[job] = 1;
+                doneChanged.notify_one();
+            }
+        });
+    }
+    for (int job = 0; job < static_cast<int>(jobs.size()); ++job) {
+        unique_lock<mutex> lock(doneMutex);
+        doneChanged.wait(lock, [&]() { return done[job] != 0; });
+        lock.unlock();
+        printSizeResult(jobs[job]);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
 
 int main() {
     ios_base::sync_with_stdio(0), cin.tie(0), cout.tie(0), cout.precision(20), cout.setf(ios::fixed);
@@ -279,7 +926,39 @@ int main() {
     bool foundPeriod = false;
     vector<vector<int>> minimumTilingRectangle;
     vector<vector<int>> maximumTiledRectangle;
-    Solver::solve(numberOfTiles, maximumSize, tiles, foundPeriod, minimumTilingRectangle, maximumTiledRectangle);
+    vector<Solver::TileSymmetry> symmetries = Solver::getTileSymmetries(tiles);
+    if (Solver::PERIOD_CANONICAL_FORM == 2) {
+        symmetries.resize(1);
+    }
+    if (Solver::PARALLEL_SIZES_OPTIMIZATION == 2) {
+        censusBySize(numberOfTiles, maximumSize, tiles, symmetries);
+        return 0;
+    }
+    auto solver = make_unique<Solver::SolverContext>();
+    map<pair<int, int>, SizeResult> results;
+    solver->startRectangles(numberOfTiles, maximumSize, tiles);
+    Solver::TableView table;
+    bool isPeriod;
+    while (solver->nextRectangle(table, isPeriod)) {
+        if (!isPeriod) {
+            continue;
+        }
+        auto& result = results[{table.n, table.m}];
+        result.h = table.n;
+        result.w = table.m;
+        if (Solver::PERIOD_CANONICAL_FORM == 1 && !result.witness.empty()) {
+            continue;
+        }
+        if (!addPeriod(result, table, symmetries)) {
+            printSizeResult(result);
+        }
+    }
+    if (Solver::PERIOD_CANONICAL_FORM != 1) {
+        for (const auto& [size, result] : results) {
+            printSizeResult(result);
+        }
+    }
+    maximumTiledRectangle = solver->getMaximumTiledRectangle();
     if (foundPeriod) {
         cout << "found the period" << endl;
         assert(!minimumTilingRectangle.empty());
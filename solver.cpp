@@ -1,196 +1,887 @@
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <queue>
+#include <tuple>
 #include <vector>
 
 using namespace std;
 
 namespace Solver{
-    int numberOfTiles; // количество тайлов
-    int maximumSize; // максимальный размер квадрата, который проверяем
-    vector<vector<int>> tiles; // заданный набор тайлов 
-
     // Перебор направлений
     // x - столбцы, y - строки
     // противоположный - ^ 2
     const vector<int> dx = {-1, 0, 1, 0}; // up, right, down, left
     const vector<int> dy = {0, 1, 0, -1};  
 
-    bool isSame(int type1, int type2, int dir1) {
-        return tiles[type1][dir1] == tiles[type2][dir1 ^ 2];
+    // Клетка прямоугольника, пустая клетка - EMPTY_CELL
+    // Если вдруг numberOfTiles будет >= 255 - нужно поставить Cell = uint16_t
+    typedef uint8_t Cell;
+    const Cell EMPTY_CELL = numeric_limits<Cell>::max();
+
+    // Прямоугольник внутри плоского буфера: n строк по m клеток подряд
+    struct TableView {
+        const Cell* cells;
+        int n;
+        int m;
+
+        Cell get(int x, int y) const {
+            return cells[x * m + y];
+        }
+    };
+
+    vector<vector<int>> toMatrix(const TableView& table) {
+        vector<vector<int>> matrix(table.n, vector<int>(table.m));
+        for (int x = 0; x < table.n; ++x) {
+            for (int y = 0; y < table.m; ++y) {
+                matrix[x][y] = table.get(x, y);
+            }
+        }
+        return matrix;
     }
 
-    // Проверка замощённого прямоугольника - является ли он периодом
-    bool isTilingRectangle(const vector<vector<int>>& table) {
-        assert(!table.empty());
-        int n = table.size();
-        assert(!table[0].empty());
-        int m = table[0].size();
+    // Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
+    const int N = 123;
 
-        for (int x = 0; x < n; ++x) {
-            // table[x][0][3] != table[x][m - 1][1]
-            if (!isSame(table[x][0], table[x][m - 1], 3)) {
-                return false;
+    // Как искать период (1 - перебор прямоугольников, 2 - циклы в графе полосок, 3 - перебор на торе,
+    // 4 - степени булевой матрицы графа полосок)
+    // В режимах 2, 3 и 4 maximumSize может быть >= N, но тогда для наборов без периода
+    // maximumTiledRectangle не считается (он есть только у перебора прямоугольников)
+    const int PERIOD_SEARCH_ENGINE = 1;
+
+    // Перебирать или не перебирать периоды x * 1 (1 - да, 2 - нет)
+    const int FIRST_SQUARE_OPTIMIZATION = 1;
+
+    // Перебирать или не перебирать периоды n * m, n < m (1 - да, 2 - нет)
+    const int LEXICOGRAPHIC_OPTIMIZATION = 1;
+
+    // Перед заполнением полоски сужать домены её клеток до тайлов, с которых полоска дозаполняется (1 - нет, 2 - да)
+    const int FORWARD_CHECKING_OPTIMIZATION = 2;
+
+    // Освобождать allTables[h - 1][w - 1], как только построен allTables[h][w] (1 - нет, 2 - да)
+    // Живут только две соседние строки корзин, а лучший незамощаемый прямоугольник запоминается сразу
+    const int ROLLING_FRONTIER_OPTIMIZATION = 2;
+
+    // Хранить прямоугольники с одинаковой границей один раз (1 - нет, 2 - да)
+    // Продолжение прямоугольника зависит только от последней строки и столбца, проверка периода -
+    // от первых и последних, так что из прямоугольников с одинаковой границей остаётся первый
+    const int BOUNDARY_OPTIMIZATION = 2;
+
+    // Перебирать размеры прямоугольников по возрастанию площади, при равной - периметра, а не по строкам (1 - нет, 2 - да)
+    // Первым находится период наименьшей площади, поэтому найденный период может отличаться от перебора по строкам
+    const int AREA_ORDER_OPTIMIZATION = 1;
+
+    // Граф периодических полосок длины length: горизонтальных (строк, у которых совпадают левый
+    // и правый край) или вертикальных (столбцов, у которых совпадают верхний и нижний край).
+    // Вершины - разрезы между соседними полосками (цвета вдоль разреза),
+    // полоска - ребро из разреза перед ней в разрез после неё.
+    // Полоску можно приставить к полоске <=> их рёбра идут подряд, поэтому
+    // период, в котором k полосок, есть <=> в графе есть замкнутый путь длины k
+    struct RowGraph {
+        int length;
+        bool vertical;
+        int numberOfCuts;
+        vector<Cell> rows; // полоски подряд по length клеток
+        vector<int> rowFrom; // разрез перед полоской (сверху для строк, слева для столбцов)
+        vector<int> rowTo; // разрез после полоски
+        vector<vector<int>> cutRows; // полоски, выходящие из разреза
+    };
+
+    // Булева матрица n * n, строки упакованы по 64 бита
+    // Для матрицы переходов графа полосок A: в A^k единица в (i, j) <=> есть путь из k полосок из разреза i в разрез j
+    struct BoolMatrix {
+        int n;
+        int words;
+        vector<unsigned long long> bits;
+
+        BoolMatrix(int _n) : n(_n), words((_n + 63) / 64), bits((size_t)_n * words, 0) {}
+
+        bool get(int i, int j) const {
+            return bits[(size_t)i * words + j / 64] >> (j % 64) & 1;
+        }
+
+        void set(int i, int j) {
+            bits[(size_t)i * words + j / 64] |= 1ULL << (j % 64);
+        }
+
+        // Строка i произведения - OR строк other, отмеченных в строке i (внутренний цикл векторизуется)
+        BoolMatrix multiply(const BoolMatrix& other) const {
+            BoolMatrix result(n);
+            for (int i = 0; i < n; ++i) {
+                unsigned long long* to = &result.bits[(size_t)i * words];
+                for (int word = 0; word < words; ++word) {
+                    for (unsigned long long mask = bits[(size_t)i * words + word]; mask; mask &= mask - 1) {
+                        const unsigned long long* from = &other.bits[(size_t)(word * 64 + __builtin_ctzll(mask)) * words];
+                        for (int j = 0; j < words; ++j) {
+                            to[j] |= from[j];
+                        }
+                    }
+                }
             }
+            return result;
         }
 
-        for (int y = 0; y < m; ++y) {
-            // table[0][y][0] != table[n - 1][y][2]
-            if (!isSame(table[0][y], table[n - 1][y], 0)) {
-                return false;
+        bool isZero() const {
+            for (unsigned long long word : bits) {
+                if (word != 0) {
+                    return false;
+                }
             }
+            return true;
         }
 
-        return true;
-    }
+        // Первая единица на диагонали произведения this * other без самого умножения:
+        // (this * other)[i][i] = 1 <=> есть j, что this[i][j] = other[j][i] = 1. false - если единиц нет
+        bool findProductDiagonal(const BoolMatrix& other, int& i, int& j) const {
+            for (i = 0; i < n; ++i) {
+                for (int word = 0; word < words; ++word) {
+                    for (unsigned long long mask = bits[(size_t)i * words + word]; mask; mask &= mask - 1) {
+                        j = word * 64 + __builtin_ctzll(mask);
+                        if (other.get(j, i)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+    };
+
+    // Всё состояние одного решателя. Контекст переиспользуется между вызовами solve():
+    // буферы сохраняют ёмкость, а чистится только та часть allTables, которую занял прошлый запуск.
+    // Контексты независимы, поэтому несколько штук могут работать одновременно в разных потоках.
+    // Внутри лежит allTables[N][N], так что контекст лучше создавать в куче или статически
+    class SolverContext {
+    public:
+        // Эта часть для внешнего доступа, запускает Solver на заданном наборе тайлов и выдаёт требуемые ответы
+        void solve(
+            const int _numberOfTiles,
+            const int _maximumSize,
+            const vector<vector<int>>& _tiles,
+            bool& _foundPeriod,
+            vector<vector<int>>& _minimumTilingRectangle,
+            vector<vector<int>>& _maximumTiledRectangle
+            ) {
+            numberOfTiles = _numberOfTiles;
+            maximumSize = _maximumSize;
+            tiles = _tiles;
+            assert(numberOfTiles < EMPTY_CELL);
+            buildCompatibleMasks();
+            run();
+            _foundPeriod = foundPeriod;
+            _minimumTilingRectangle = minimumTilingRectangle;
+            _maximumTiledRectangle = maximumTiledRectangle;
+        }
+
+    private:
+        int numberOfTiles; // количество тайлов
+        int maximumSize; // максимальный размер квадрата, который проверяем
+        vector<vector<int>> tiles; // заданный набор тайлов 
+
+        bool isSame(int type1, int type2, int dir1) {
+            return tiles[type1][dir1] == tiles[type2][dir1 ^ 2];
+        }
+
+        // Проверка замощённого прямоугольника - является ли он периодом
+        bool isTilingRectangle(const TableView& table) {
+            assert(table.n > 0);
+            int n = table.n;
+            assert(table.m > 0);
+            int m = table.m;
 
-    // Проверка для точки на принадлежность bounding box
-    bool isInTable(const vector<vector<int>>& table, int x, int y) {
-        if (table.empty() || table[0].empty()) {
+            for (int x = 0; x < n; ++x) {
+                // table[x][0][3] != table[x][m - 1][1]
+                if (!isSame(table.get(x, 0), table.get(x, m - 1), 3)) {
+                    return false;
+                }
+            }
+
+            for (int y = 0; y < m; ++y) {
+                // table[0][y][0] != table[n - 1][y][2]
+                if (!isSame(table.get(0, y), table.get(n - 1, y), 0)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Проверка для точки на принадлежность bounding box
+        bool isInTable(const TableView& table, int x, int y) {
+            return x >= 0 && x < table.n && y >= 0 && y < table.m;
+        }
+
+        // Маски совместимости, строятся один раз на solve()
+        // бит type в слове compatibleMask[dir][other * maskWords + type / 64] стоит, если тайл type
+        // можно поставить так, чтобы тайл other оказался его соседом в направлении dir
+        int maskWords;
+        vector<unsigned long long> compatibleMask[4];
+
+        void buildCompatibleMasks() {
+            maskWords = (numberOfTiles + 63) / 64;
+            for (int dir = 0; dir < 4; ++dir) {
+                compatibleMask[dir].assign(numberOfTiles * maskWords, 0);
+                for (int other = 0; other < numberOfTiles; ++other) {
+                    for (int type = 0; type < numberOfTiles; ++type) {
+                        if (isSame(type, other, dir)) {
+                            compatibleMask[dir][other * maskWords + type / 64] |= 1ULL << (type % 64);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Маска тайлов из слова word, которые можно поставить в данную точку
+        unsigned long long getCandidates(const TableView& table, int x, int y, int word) {
+            assert(isInTable(table, x, y));
+
+            unsigned long long candidates = ~0ULL;
+            if (word == maskWords - 1 && numberOfTiles % 64 != 0) {
+                candidates = (1ULL << (numberOfTiles % 64)) - 1;
+            }
+
+            for (int dir = 0; dir < 4 && candidates; ++dir) {
+                int nx = x + dx[dir];
+                int ny = y + dy[dir];
+                if (!isInTable(table, nx, ny)) continue;
+                if (table.get(nx, ny) == EMPTY_CELL) continue;
+                candidates &= compatibleMask[dir][table.get(nx, ny) * maskWords + word];
+            }
+
+            return candidates;
+        }
+
+        // конструкции вида: vector<vector<vector<vector<vector<int>>>>> - это смерть, 3 - тоже плохо, но не совсем смерть
+        // поэтому все прямоугольники h * w лежат подряд в одном буфере allTables[h][w]
+        vector<Cell> allTables[N][N];
+        vector<Cell> currentTable; // прямоугольник, который сейчас заполняет recTryToAdd
+        vector<vector<int>> minimumTilingRectangle;
+        vector<vector<int>> maximumTiledRectangle;
+        bool foundPeriod;
+        int usedSize = 0; // до какого размера заняты allTables с прошлого запуска
+        // последний в порядке по строкам (h, затем w) незамощаемый прямоугольник с w <= h:
+        // lastH = 0 - его нет, lastIndex = -1 - его нет или он уже скопирован в maximumTiledRectangle
+        int lastH, lastW, lastIndex;
+        // Открытая адресация по хешу границы: номера прямоугольников заполняемого allTables[h][w], -1 - пусто
+        vector<int> boundaryTable;
+        int numberOfBoundaries = 0;
+
+        // Хеш первой и последней строк, первого и последнего столбцов
+        unsigned long long getBoundaryHash(const TableView& table) {
+            unsigned long long hash = 14695981039346656037ULL;
+            for (int y = 0; y < table.m; ++y) {
+                hash = (hash ^ table.get(0, y)) * 1099511628211ULL;
+                hash = (hash ^ table.get(table.n - 1, y)) * 1099511628211ULL;
+            }
+            for (int x = 0; x < table.n; ++x) {
+                hash = (hash ^ table.get(x, 0)) * 1099511628211ULL;
+                hash = (hash ^ table.get(x, table.m - 1)) * 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        bool isSameBoundary(const TableView& table1, const TableView& table2) {
+            for (int y = 0; y < table1.m; ++y) {
+                if (table1.get(0, y) != table2.get(0, y) || table1.get(table1.n - 1, y) != table2.get(table2.n - 1, y)) {
+                    return false;
+                }
+            }
+            for (int x = 0; x < table1.n; ++x) {
+                if (table1.get(x, 0) != table2.get(x, 0) || table1.get(x, table1.m - 1) != table2.get(x, table2.m - 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void clearBoundaries() {
+            boundaryTable.assign(16, -1);
+            numberOfBoundaries = 0;
+        }
+
+        void insertBoundary(int h, int w, int index) {
+            size_t mask = boundaryTable.size() - 1;
+            size_t cell = getBoundaryHash(getTable(h, w, index)) & mask;
+            while (boundaryTable[cell] != -1) {
+                cell = (cell + 1) & mask;
+            }
+            boundaryTable[cell] = index;
+        }
+
+        // Есть ли в allTables[table.n][table.m] прямоугольник с такой же границей, если нет - запоминает,
+        // что table будет лежать там под номером countTables(table.n, table.m)
+        bool isKnownBoundary(const TableView& table) {
+            int h = table.n, w = table.m;
+            if (h < 3 || w < 3) {
+                return false; // внутренности нет, граница - весь прямоугольник
+            }
+            if (2 * (numberOfBoundaries + 1) > (int)boundaryTable.size()) {
+                boundaryTable.assign(2 * boundaryTable.size(), -1);
+                for (int index = 0; index < numberOfBoundaries; ++index) {
+                    insertBoundary(h, w, index);
+                }
+            }
+            size_t mask = boundaryTable.size() - 1;
+            size_t cell = getBoundaryHash(table) & mask;
+            while (boundaryTable[cell] != -1) {
+                if (isSameBoundary(getTable(h, w, boundaryTable[cell]), table)) {
+                    return true;
+                }
+                cell = (cell + 1) & mask;
+            }
+            boundaryTable[cell] = numberOfBoundaries++;
             return false;
         }
 
-        return x >= 0 && x < (int)table.size() && y >= 0 && y < (int)table[0].size();
-    }
+        // Количество прямоугольников h * w (прямоугольник с нулевой стороной ровно один - пустой)
+        int countTables(int h, int w) {
+            if (h == 0 || w == 0) {
+                return 1;
+            }
+            return allTables[h][w].size() / (h * w);
+        }
 
-    // Проверка для тайла можно ли его поставить в данную точку
-    bool canPutTile(const vector<vector<int>>& table, int x, int y, int type) {
-        //cout << "x = " << x << " y = " << y << endl;
-        assert(isInTable(table, x, y));
+        TableView getTable(int h, int w, int index) {
+            return {allTables[h][w].data() + (size_t)index * h * w, h, w};
+        }
 
-        for (int dir = 0; dir < 4; ++dir) {
-            int nx = x + dx[dir];
-            int ny = y + dy[dir];
-            if (!isInTable(table, nx, ny)) continue;
-            if (table[nx][ny] == -1) continue;
-            if (!isSame(type, table[nx][ny], dir)) {
-                return false;
+        // Освободить память allTables[h][w], перед этим скопировав из него последний незамощаемый прямоугольник
+        void freeTables(int h, int w) {
+            if (lastIndex != -1 && lastH == h && lastW == w) {
+                maximumTiledRectangle = toMatrix(getTable(h, w, lastIndex));
+                lastIndex = -1;
             }
+            vector<Cell>().swap(allTables[h][w]);
         }
 
-        return true;
-    }
+        // Обновить ответы замощённым прямоугольником
+        void relaxAnswers(const TableView& table) {
+            if (BOUNDARY_OPTIMIZATION == 2 && isKnownBoundary(table)) {
+                return;
+            }
+            if (isTilingRectangle(table)) {
+                minimumTilingRectangle = toMatrix(table);
+                foundPeriod = true;
+            } else if (ROLLING_FRONTIER_OPTIMIZATION == 2 && table.m <= table.n) {
+                // размеры могут строиться не по строкам (AREA_ORDER), а ответ - последний по строкам
+                if (table.n > lastH || (table.n == lastH && table.m >= lastW)) {
+                    lastH = table.n, lastW = table.m, lastIndex = countTables(table.n, table.m);
+                }
+            }
+            auto& bucket = allTables[table.n][table.m];
+            bucket.insert(bucket.end(), table.cells, table.cells + table.n * table.m);
+        }
 
-    // конструкции вида: vector<vector<vector<vector<vector<int>>>>> - это смерть, 3 - тоже плохо, но не совсем смерть
-    // Если вдруг maximumSize будет >= 123 - нужно поставить N = maximumSize + 1
-    const int N = 123;
-    vector<vector<vector<int>>> allTables[N][N];
-    vector<vector<int>> minimumTilingRectangle;
-    vector<vector<int>> maximumTiledRectangle;
-    bool foundPeriod;
+        // Домены клеток полоски: stripDomains[i * maskWords + word] - тайлы из слова word,
+        // которые можно поставить в i-ю по порядку заполнения клетку так, чтобы полоска дозаполнилась
+        vector<unsigned long long> stripDomains;
 
-    // Обновить ответы замощённым прямоугольником
-    void relaxAnswers(const vector<vector<int>>& table) {
-        if (isTilingRectangle(table)) {
-            minimumTilingRectangle = table;
-            foundPeriod = true;
+        // Порядок заполнения полоски: нижняя строка слева направо, потом правый столбец снизу вверх
+        int getStripIndex(const TableView& table, int x, int y) {
+            return x == table.n - 1 ? y : table.m - 1 + (table.n - 1 - x);
+        }
+
+        // В полоске каждая клетка соседствует только с предыдущей и следующей, поэтому одного прохода
+        // с конца хватает, чтобы в доменах остались ровно дозаполняемые тайлы: перебор не заходит в тупики,
+        // а клетки с одним вариантом проходятся без ветвления. false - полоску заполнить нельзя
+        bool buildStripDomains(const TableView& table) {
+            int length = table.n + table.m - 1;
+            stripDomains.assign(length * maskWords, 0);
+            for (int i = length - 1; i >= 0; --i) {
+                int x = i < table.m ? table.n - 1 : table.n - 1 - (i - (table.m - 1));
+                int y = i < table.m ? i : table.m - 1;
+                unsigned long long* domain = &stripDomains[i * maskWords];
+                if (i + 1 < length) {
+                    int dir = i + 1 < table.m ? 1 : 0; // следующая клетка справа или сверху
+                    const unsigned long long* nextDomain = &stripDomains[(i + 1) * maskWords];
+                    for (int word = 0; word < maskWords; ++word) {
+                        unsigned long long next = nextDomain[word];
+                        while (next) {
+                            int type = word * 64 + __builtin_ctzll(next);
+                            next &= next - 1;
+                            for (int to = 0; to < maskWords; ++to) {
+                                domain[to] |= compatibleMask[dir][type * maskWords + to];
+                            }
+                        }
+                    }
+                } else {
+                    for (int word = 0; word < maskWords; ++word) {
+                        domain[word] = ~0ULL;
+                    }
+                }
+                bool isEmpty = true;
+                for (int word = 0; word < maskWords; ++word) {
+                    domain[word] &= getCandidates(table, x, y, word);
+                    isEmpty &= domain[word] == 0;
+                }
+                if (isEmpty) {
+                    return false;
+                }
+            }
+            return true;
         }
-        allTables[table.size()][table[0].size()].push_back(table);
-    }
 
-    // Рекурсивная штука пытается заполнить полоску от таблички (из -1)
-    //  0  1 -1
-    //  1  2 -1
-    // -1 -1 -1
-    void recTryToAdd(vector<vector<int>>& table, int x, int y) {
-        if (x == -1) {
-            relaxAnswers(table);
-        } else {
-            assert(!table.empty());
-            assert(!table[0].empty());
-            int m = table[0].size();
-
-            int nx = x, ny = y;
-            if (ny + 1 < m) {
-                ++ny;
+        // Рекурсивная штука пытается заполнить полоску от таблички (из EMPTY_CELL)
+        //  0  1 -1
+        //  1  2 -1
+        // -1 -1 -1
+        void recTryToAdd(const TableView& table, int x, int y) {
+            if (x == -1) {
+                relaxAnswers(table);
             } else {
-                --nx;
+                int m = table.m;
+
+                int nx = x, ny = y;
+                if (ny + 1 < m) {
+                    ++ny;
+                } else {
+                    --nx;
+                }
+
+                for (int word = 0; word < maskWords; ++word) {
+                    unsigned long long candidates = getCandidates(table, x, y, word);
+                    if (FORWARD_CHECKING_OPTIMIZATION == 2) {
+                        candidates &= stripDomains[getStripIndex(table, x, y) * maskWords + word];
+                    }
+                    while (candidates) {
+                        int type = word * 64 + __builtin_ctzll(candidates);
+                        candidates &= candidates - 1;
+
+                        currentTable[x * m + y] = type;
+                        recTryToAdd(table, nx, ny);
+                        currentTable[x * m + y] = EMPTY_CELL;
+                    }
+                }
+            }
+        }    
+
+        // Расширяет прямоугольник в нужную сторону и запускает рекурсию
+        void tryToAdd(const TableView& baseTable, int n, int m) {
+            currentTable.assign(n * m, EMPTY_CELL);
+            for (int x = 0; x < baseTable.n; ++x) {
+                for (int y = 0; y < baseTable.m; ++y) {
+                    currentTable[x * m + y] = baseTable.get(x, y);
+                }
             }
 
-            for (int type = 0; type < numberOfTiles; ++type) {
-                if (!canPutTile(table, x, y, type)) continue;
-                
-                table[x][y] = type;
-                recTryToAdd(table, nx, ny);
-                table[x][y] = -1;
+            TableView table = {currentTable.data(), n, m};
+            if (FORWARD_CHECKING_OPTIMIZATION == 2 && !buildStripDomains(table)) {
+                return;
             }
+            recTryToAdd(table, n - 1, 0);
         }
-    }    
 
-    // Расширяет прямоугольник в нужную сторону и запускает рекурсию
-    void tryToAdd(const vector<vector<int>>& baseTable, int n, int m) {
-        auto table = baseTable;
-        for (int x = 0; x < n; ++x) {
-            if (table.size() == x) {
-                table.push_back(vector<int>(m, -1));
+        // Маска всех тайлов из слова word
+        unsigned long long getAllTilesMask(int word) {
+            if (word == maskWords - 1 && numberOfTiles % 64 != 0) {
+                return (1ULL << (numberOfTiles % 64)) - 1;
             }
-            while (table[x].size() < m) {
-                table[x].push_back(-1);
+            return ~0ULL;
+        }
+
+        int getCut(RowGraph& graph, map<vector<int>, int>& cuts, const vector<int>& colors) {
+            auto it = cuts.find(colors);
+            if (it != cuts.end()) {
+                return it->second;
             }
+            cuts[colors] = graph.numberOfCuts;
+            graph.cutRows.push_back({});
+            return graph.numberOfCuts++;
         }
 
-        recTryToAdd(table, n - 1, 0);
-    }
+        // Перебор полосок от первой клетки к последней
+        void recGenRows(RowGraph& graph, map<vector<int>, int>& cuts, vector<Cell>& row, int i) {
+            int length = graph.length;
+            int alongDir = graph.vertical ? 2 : 1; // куда идёт полоска
+            int fromDir = graph.vertical ? 3 : 0; // сторона, смотрящая на предыдущую полоску
+            if (i == length) {
+                if (!isSame(row[length - 1], row[0], alongDir)) {
+                    return;
+                }
+                vector<int> fromColors(length), toColors(length);
+                for (int j = 0; j < length; ++j) {
+                    fromColors[j] = tiles[row[j]][fromDir];
+                    toColors[j] = tiles[row[j]][fromDir ^ 2];
+                }
+                int from = getCut(graph, cuts, fromColors);
+                int to = getCut(graph, cuts, toColors);
+                graph.cutRows[from].push_back(graph.rowFrom.size());
+                graph.rowFrom.push_back(from);
+                graph.rowTo.push_back(to);
+                graph.rows.insert(graph.rows.end(), row.begin(), row.end());
+            } else {
+                for (int word = 0; word < maskWords; ++word) {
+                    unsigned long long candidates = getAllTilesMask(word);
+                    if (i > 0) {
+                        // предыдущая клетка полоски
+                        candidates &= compatibleMask[alongDir ^ 2][row[i - 1] * maskWords + word];
+                    }
+                    while (candidates) {
+                        row[i] = word * 64 + __builtin_ctzll(candidates);
+                        candidates &= candidates - 1;
+                        recGenRows(graph, cuts, row, i + 1);
+                    }
+                }
+            }
+        }
 
-    // Перебирать или не перебирать периоды x * 1 (1 - да, 2 - нет)
-    const int FIRST_SQUARE_OPTIMIZATION = 1;
+        RowGraph buildRowGraph(int length, bool vertical) {
+            RowGraph graph;
+            graph.length = length;
+            graph.vertical = vertical;
+            graph.numberOfCuts = 0;
+            map<vector<int>, int> cuts;
+            vector<Cell> row(length);
+            recGenRows(graph, cuts, row, 0);
+            return graph;
+        }
 
-    // Перебирать или не перебирать периоды n * m, n < m (1 - да, 2 - нет)
-    const int LEXICOGRAPHIC_OPTIMIZATION = 1;
+        // Компоненты сильной связности (Тарьян), нужны чтобы искать циклы только внутри компонент
+        void tarjan(const RowGraph& graph, int v, int& timer, vector<int>& tin, vector<int>& low, vector<int>& stack, vector<bool>& inStack, vector<int>& component, int& numberOfComponents) {
+            tin[v] = low[v] = timer++;
+            stack.push_back(v);
+            inStack[v] = true;
+            for (int row : graph.cutRows[v]) {
+                int u = graph.rowTo[row];
+                if (tin[u] == -1) {
+                    tarjan(graph, u, timer, tin, low, stack, inStack, component, numberOfComponents);
+                    low[v] = min(low[v], low[u]);
+                } else if (inStack[u]) {
+                    low[v] = min(low[v], tin[u]);
+                }
+            }
+            if (low[v] == tin[v]) {
+                while (true) {
+                    int u = stack.back();
+                    stack.pop_back();
+                    inStack[u] = false;
+                    component[u] = numberOfComponents;
+                    if (u == v) break;
+                }
+                ++numberOfComponents;
+            }
+        }
+
+        // Кратчайший замкнутый путь длины не больше maximumLength
+        // возвращает полоски цикла по порядку, пустой вектор - если такого нет
+        vector<int> findShortestCycle(const RowGraph& graph, int maximumLength) {
+            int n = graph.numberOfCuts;
+            int timer = 0, numberOfComponents = 0;
+            vector<int> tin(n, -1), low(n), stack, component(n);
+            vector<bool> inStack(n, false);
+            for (int v = 0; v < n; ++v) {
+                if (tin[v] == -1) {
+                    tarjan(graph, v, timer, tin, low, stack, inStack, component, numberOfComponents);
+                }
+            }
+
+            vector<int> bestCycle;
+            vector<int> dist(n, -1), parentRow(n, -1), queue;
+            for (int start = 0; start < n; ++start) {
+                // bfs из start внутри его компоненты
+                queue.assign(1, start);
+                dist[start] = 0;
+                int lastRow = -1;
+                for (size_t i = 0; i < queue.size() && lastRow == -1; ++i) {
+                    int v = queue[i];
+                    if (dist[v] + 1 > maximumLength) break;
+                    for (int row : graph.cutRows[v]) {
+                        int u = graph.rowTo[row];
+                        if (component[u] != component[start]) continue;
+                        if (u == start) {
+                            lastRow = row;
+                            break;
+                        }
+                        if (dist[u] != -1) continue;
+                        dist[u] = dist[v] + 1;
+                        parentRow[u] = row;
+                        queue.push_back(u);
+                    }
+                }
+                if (lastRow != -1) {
+                    vector<int> cycle = {lastRow};
+                    for (int v = graph.rowFrom[lastRow]; v != start; v = graph.rowFrom[parentRow[v]]) {
+                        cycle.push_back(parentRow[v]);
+                    }
+                    reverse(cycle.begin(), cycle.end());
+                    bestCycle = cycle;
+                    maximumLength = cycle.size() - 1;
+                }
+                for (int v : queue) {
+                    dist[v] = -1;
+                }
+            }
+            return bestCycle;
+        }
+
+        // Поиск минимального периода через граф полосок. Высоты перебираются по возрастанию,
+        // для высоты h строится граф столбцов высоты h и в нём ищется кратчайший цикл - это
+        // минимальная ширина. Первая высота, где цикл нашёлся, и даёт ответ (как в переборе прямоугольников)
+        void runRowGraph() {
+            foundPeriod = false;
+            for (int h = 1; h <= maximumSize && !foundPeriod; ++h) {
+                RowGraph graph = buildRowGraph(h, true);
+                vector<int> cycle = findShortestCycle(graph, maximumSize);
+                if (cycle.empty()) {
+                    continue;
+                }
+                setPeriodFromColumns(graph, cycle);
+            }
+        }
+
+        // Период из замкнутого пути по графу столбцов: столбцы пути идут слева направо
+        void setPeriodFromColumns(const RowGraph& graph, const vector<int>& cycle) {
+            int h = graph.length;
+            int w = cycle.size();
+            minimumTilingRectangle.assign(h, vector<int>(w));
+            for (int x = 0; x < h; ++x) {
+                for (int y = 0; y < w; ++y) {
+                    minimumTilingRectangle[x][y] = graph.rows[cycle[y] * h + x];
+                }
+            }
+            foundPeriod = true;
+        }
+
+        // Дописывает в walk путь из length полосок из разреза from в разрез to (powers[k] - степени матрицы переходов):
+        // из v идём по полоске в u, из которого есть путь нужной длины в to
+        void appendWalk(const RowGraph& graph, const vector<BoolMatrix>& powers, int from, int to, int length, vector<int>& walk) {
+            for (int v = from; length > 0; --length) {
+                int next = -1;
+                for (int row : graph.cutRows[v]) {
+                    if (powers[length - 1].get(graph.rowTo[row], to)) {
+                        next = row;
+                        break;
+                    }
+                }
+                assert(next != -1);
+                walk.push_back(next);
+                v = graph.rowTo[next];
+            }
+        }
 
-    // main
-    void run() {
-        for (int h = 0; h <= maximumSize; ++h) {
-            for (int w = 0; w <= maximumSize; ++w) {
-                allTables[h][w].clear();
-                if (h == 0 || w == 0) {
-                    allTables[h][w].push_back(vector<vector<int>>());
+        // Поиск минимального периода степенями матрицы переходов A графа столбцов высоты h:
+        // период h * w есть <=> на диагонали A^w есть единица. A^w = A^((w + 1) / 2) * A^(w / 2), а диагональ
+        // произведения проверяется без умножения, так что степени нужны только до (maximumSize + 1) / 2.
+        // Первая подходящая ширина - минимальная. Высоты по возрастанию, как в runRowGraph
+        void runMatrixPowers() {
+            foundPeriod = false;
+            for (int h = 1; h <= maximumSize && !foundPeriod; ++h) {
+                RowGraph graph = buildRowGraph(h, true);
+                int n = graph.numberOfCuts;
+                vector<BoolMatrix> powers(2, BoolMatrix(n));
+                for (int v = 0; v < n; ++v) {
+                    powers[0].set(v, v);
+                }
+                for (int row = 0; row < (int)graph.rowFrom.size(); ++row) {
+                    powers[1].set(graph.rowFrom[row], graph.rowTo[row]);
+                }
+                for (int w = 1; w <= maximumSize; ++w) {
+                    int leftLength = (w + 1) / 2;
+                    int rightLength = w / 2;
+                    if ((int)powers.size() <= leftLength) {
+                        powers.push_back(powers.back().multiply(powers[1]));
+                    }
+                    if (powers[leftLength].isZero()) {
+                        break; // путей такой длины нет, длиннее тоже не будет
+                    }
+                    int start, middle;
+                    if (!powers[leftLength].findProductDiagonal(powers[rightLength], start, middle)) {
+                        continue;
+                    }
+                    vector<int> cycle;
+                    appendWalk(graph, powers, start, middle, leftLength, cycle);
+                    appendWalk(graph, powers, middle, start, rightLength, cycle);
+                    setPeriodFromColumns(graph, cycle);
+                    break;
+                }
+            }
+        }
+
+        // Перебор прямоугольников по возрастанию размера
+        // Достраивает allTables[h][w] из allTables[h - 1][w - 1]
+        void buildShape(int h, int w) {
+            clearBoundaries();
+            for (int index = 0; index < countTables(h - 1, w - 1); ++index) {
+                if (foundPeriod) {
+                    break;
+                } else {
+                    tryToAdd(getTable(h - 1, w - 1, index), h, w);
+                }
+            }
+            if (ROLLING_FRONTIER_OPTIMIZATION == 2) {
+                freeTables(h - 1, w - 1);
+            }
+        }
+
+        // Размеры из shapes по возрастанию площади, при равной - периметра. Размер попадает в очередь,
+        // когда построена его основа allTables[h - 1][w - 1] или основы нет среди shapes, так что основа
+        // всегда готова, и каждая корзина по-прежнему нужна только следующему размеру по диагонали.
+        // За пустым размером его продолжения не строятся
+        void runAreaOrder(const vector<pair<int, int>>& shapes) {
+            vector<vector<char>> isShape(maximumSize + 2, vector<char>(maximumSize + 2, 0));
+            for (auto [h, w] : shapes) {
+                isShape[h][w] = 1;
+            }
+            priority_queue<tuple<int, int, int>, vector<tuple<int, int, int>>, greater<tuple<int, int, int>>> order;
+            for (auto [h, w] : shapes) {
+                if (!isShape[h - 1][w - 1]) {
+                    order.push({h * w, h + w, h});
+                }
+            }
+            while (!order.empty() && !foundPeriod) {
+                auto [area, perimeter, h] = order.top();
+                order.pop();
+                int w = area / h;
+                buildShape(h, w);
+                if (countTables(h, w) > 0 && isShape[h + 1][w + 1]) {
+                    order.push({(h + 1) * (w + 1), h + w + 2, h + 1});
                 }
             }
-        } 
+        }
 
-        foundPeriod = false;
+        void runRectangles() {
+            for (int h = 0; h <= usedSize; ++h) {
+                for (int w = 0; w <= usedSize; ++w) {
+                    allTables[h][w].clear();
+                }
+            } 
+            usedSize = maximumSize;
+
+            foundPeriod = false;
+            maximumTiledRectangle.clear();
+            lastH = 0, lastW = 0, lastIndex = -1;
 
-        for (int h = 1; h <= maximumSize && !foundPeriod; ++h) {
-            for (int w = min(h, FIRST_SQUARE_OPTIMIZATION); w <= (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h) && !foundPeriod; ++w) {
-                for (const auto& baseTable : allTables[h - 1][w - 1]) {
+            vector<pair<int, int>> shapes;
+            for (int h = 1; h <= maximumSize; ++h) {
+                for (int w = min(h, FIRST_SQUARE_OPTIMIZATION); w <= (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h); ++w) {
+                    shapes.push_back({h, w});
+                }
+            }
+            if (AREA_ORDER_OPTIMIZATION == 2) {
+                runAreaOrder(shapes);
+            } else {
+                for (auto [h, w] : shapes) {
                     if (foundPeriod) {
                         break;
-                    } else {
-                        tryToAdd(baseTable, h, w);
                     }
+                    buildShape(h, w);
+                }
+            }
+
+            if (ROLLING_FRONTIER_OPTIMIZATION == 1) {
+                lastIndex = -1;
+                for (int h = 1; h <= maximumSize; ++h) {
+                    for (int w = 1; w <= h; ++w) {
+                        for (int index = 0; index < countTables(h, w); ++index) {
+                            if (!isTilingRectangle(getTable(h, w, index))) {
+                                lastIndex = index, lastH = h, lastW = w;
+                            }
+                        }
+                    }
+                }
+            }
+            if (lastIndex != -1) {
+                maximumTiledRectangle = toMatrix(getTable(lastH, lastW, lastIndex));
+            }
+        }
+
+        vector<Cell> torus; // тор h * w, который заполняет recTorus
+
+        // Маска тайлов из слова word, которые можно поставить в клетку тора (соседи через край тоже соседи)
+        unsigned long long getTorusCandidates(int h, int w, int x, int y, int word) {
+            unsigned long long candidates = getAllTilesMask(word);
+            for (int dir = 0; dir < 4 && candidates; ++dir) {
+                int nx = (x + dx[dir] + h) % h;
+                int ny = (y + dy[dir] + w) % w;
+                if (nx == x && ny == y) {
+                    // при h == 1 или w == 1 клетка соседствует сама с собой
+                    for (unsigned long long rest = candidates; rest; rest &= rest - 1) {
+                        int type = word * 64 + __builtin_ctzll(rest);
+                        if (!isSame(type, type, dir)) {
+                            candidates &= ~(1ULL << (type % 64));
+                        }
+                    }
+                } else if (torus[nx * w + ny] != EMPTY_CELL) {
+                    candidates &= compatibleMask[dir][torus[nx * w + ny] * maskWords + word];
+                }
+            }
+            return candidates;
+        }
+
+        // Заполняет тор, каждый раз выбирая пустую клетку с наименьшим числом вариантов
+        bool recTorus(int h, int w, int filled) {
+            if (filled == h * w) {
+                return true;
+            }
+            int bestCell = -1, bestCount = numberOfTiles + 1;
+            for (int cell = 0; cell < h * w && bestCount > 1; ++cell) {
+                if (torus[cell] != EMPTY_CELL) {
+                    continue;
+                }
+                int count = 0;
+                for (int word = 0; word < maskWords; ++word) {
+                    count += __builtin_popcountll(getTorusCandidates(h, w, cell / w, cell % w, word));
+                }
+                if (count == 0) {
+                    return false;
+                }
+                if (count < bestCount) {
+                    bestCell = cell, bestCount = count;
+                }
+            }
+
+            for (int word = 0; word < maskWords; ++word) {
+                unsigned long long candidates = getTorusCandidates(h, w, bestCell / w, bestCell % w, word);
+                while (candidates) {
+                    int type = word * 64 + __builtin_ctzll(candidates);
+                    candidates &= candidates - 1;
+
+                    torus[bestCell] = type;
+                    if (recTorus(h, w, filled + 1)) {
+                        return true;
+                    }
+                    torus[bestCell] = EMPTY_CELL;
                 }
             }
+            return false;
         }
 
-        for (int h = 1; h <= maximumSize; ++h) {
-            for (int w = 1; w <= h; ++w) {
-                for (const auto& table : allTables[h][w]) {
-                    if (!isTilingRectangle(table)) {
-                        maximumTiledRectangle = table;
+        // Периоды по возрастанию размера, каждый ищется сразу на торе h * w,
+        // поэтому прямоугольники без периода не строятся и не хранятся
+        void runTorus() {
+            foundPeriod = false;
+            for (int h = 1; h <= maximumSize && !foundPeriod; ++h) {
+                for (int w = min(h, FIRST_SQUARE_OPTIMIZATION); w <= (LEXICOGRAPHIC_OPTIMIZATION == 1 ? maximumSize : h) && !foundPeriod; ++w) {
+                    torus.assign(h * w, EMPTY_CELL);
+                    if (recTorus(h, w, 0)) {
+                        foundPeriod = true;
+                        minimumTilingRectangle = toMatrix({torus.data(), h, w});
                     }
                 }
             }
         }
-    }
 
-    // Эта часть для внешнего доступа, запускает Solver на заданном наборе тайлов и выдаёт требуемые ответы
-    void solve(
-        const int _numberOfTiles,
-        const int _maximumSize,
-        const vector<vector<int>>& _tiles,
-        bool& _foundPeriod,
-        vector<vector<int>>& _minimumTilingRectangle,
-        vector<vector<int>>& _maximumTiledRectangle
-        ) {
-        numberOfTiles = _numberOfTiles;
-        maximumSize = _maximumSize;
-        tiles = _tiles;
-        run();
-        _foundPeriod = foundPeriod;
-        _minimumTilingRectangle = minimumTilingRectangle;
-        _maximumTiledRectangle = maximumTiledRectangle;
-    }
+        // main
+        void run() {
+            if (PERIOD_SEARCH_ENGINE != 1) {
+                if (PERIOD_SEARCH_ENGINE == 2) {
+                    runRowGraph();
+                } else if (PERIOD_SEARCH_ENGINE == 3) {
+                    runTorus();
+                } else {
+                    runMatrixPowers();
+                }
+                if (foundPeriod || maximumSize >= N) {
+                    return;
+                }
+            }
+            runRectangles();
+        }
+    };
 };
 
 int main() {
@@ -210,7 +901,8 @@ int main() {
     bool foundPeriod = false;
     vector<vector<int>> minimumTilingRectangle;
     vector<vector<int>> maximumTiledRectangle;
-    Solver::solve(numberOfTiles, maximumSize, tiles, foundPeriod, minimumTilingRectangle, maximumTiledRectangle);
+    auto solver = make_unique<Solver::SolverContext>();
+    solver->solve(numberOfTiles, maximumSize, tiles, foundPeriod, minimumTilingRectangle, maximumTiledRectangle);
     if (foundPeriod) {
         cout << "found the period" << endl;
         assert(!minimumTilingRectangle.empty());
@@ -226,7 +918,11 @@ int main() {
         }
     } else {
         cout << "didn't find a period" << endl;
-        assert(!maximumTiledRectangle.empty());
+        if (maximumTiledRectangle.empty()) {
+            // так бывает только при поиске по графу полосок с maximumSize >= N
+            cout << "maximum tiled rectangle wasn't computed" << endl;
+            return 0;
+        }
         int n = maximumTiledRectangle.size();
         assert(!maximumTiledRectangle.empty());
         int m = maximumTiledRectangle[0].size();